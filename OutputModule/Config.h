@@ -22,8 +22,32 @@
 #define LCD_SHIELD_DETECT_PIN      11   // Use this pin (must be low) to detect presence of LCD shield. If zero, don't detect.
 #define LCD_I2C                  true   // Include code for LCD connected by I2C.
 
+// Input nodes.
+#define INPUT_INTERRUPT_PIN        12   // Pin wired to all the Input nodes' (open-drain) INT pins. If zero, just poll the Input nodes.
+#define INPUT_INTERRUPT_MISSES      3   // Consecutive changes found without an interrupt before just polling the Input nodes.
+#define INPUT_CAPTURE           false   // Use the Input nodes' interrupt capture to catch presses shorter than the debounce, they're held until debounced.
+#define INPUT_CACHE_SIZE            4   // Number of recently used Inputs' definitions kept in RAM, 8 bytes each.
+#define INPUT_EVENT_MAX             8   // Number of Input changes that can be queued waiting to be actioned, 6 bytes each.
+
+// Output nodes.
+#define OUTPUT_LOCK_CACHE_SIZE      6   // Number of recently used Outputs' locks kept in RAM, 28 bytes each. At least INPUT_OUTPUT_MAX.
+#define OUTPUT_TIMELINE_MAX         8   // Number of delayed Output changes the master can time itself, 6 bytes each.
+#define COMMS_BUSY_DELAY            1   // Delay in msecs before asking a busy Output node for its response again.
+#define COMMS_BUSY_POLLS            4   // Times to ask a busy Output node, before leaving its response until later.
+#define COMMS_SAVE_POLLS           25   // Times to ask again (COMMS_BUSY_POLLS each) for a response that can't wait, long enough for an Output node to save an Output.
+#define COMMS_HOLD_DELAY            5   // Delay in msecs before checking again whether an Output node's holding off.
+#define COMMS_HOLD_POLLS           20   // Times to check an Output node that's holding off, long enough for it to save an Output.
+
+// I2C health.
+#define HEALTH_RETRIES              2   // Times a failed read is retried before it counts as an error.
+#define HEALTH_BACKOFF              1   // Delay in msecs before the first retry, doubled for each further retry.
+#define HEALTH_ERROR_WEIGHT         4   // Each error adds this to a node's error count, each success takes one away.
+#define HEALTH_ERROR_LIMIT         16   // Take a node offline when its error count reaches this.
+#define HEALTH_WIRE_TIMEOUT    25000L   // Microsecs before a stuck i2c transaction is abandoned.
+
 
 // i2c node numbers.
+#define I2C_BROADCAST_ID         0x00   // General call ID, received by all Output nodes.
 #define I2C_CONTROLLER_ID        0x10   // Controller ID.
 #define I2C_INPUT_BASE_ID        0x20   // Input nodes' base ID.
 #define I2C_OUTPUT_BASE_ID       0x50   // Output nodes' base ID.
@@ -47,8 +71,10 @@
 
 
 // Steps
-#define STEP_HARDWARE_SCAN     10000L   // Re-scan for new hardware every 10 seconds.
-#define STEP_INPUT_SCAN           50L   // Steps in msecs between scans of the input switches.
+#define STEP_HARDWARE_PROBE       50L   // Steps in msecs between probes of a hardware address (round-robin).
+#define STEP_HARDWARE_ROUND    10000L   // Steps in msecs between the starts of rounds of probes of all the hardware addresses.
+#define STEP_INPUT_SCAN            5L   // Steps in msecs between scans of the input switches.
+#define STEP_INPUT_POLL         1000L   // Steps in msecs between fallback scans of all the input switches when using interrupts.
 #define STEP_HEARTBEAT           200L   // Steps in msecs between changes of the heartbeat indicator.
 #define STEP_SERVO                25L   // Delay (msecs) between steps of a Servo.
 #define STEP_LED                   5L   // Delay (msecs) between steps of a LED.
@@ -71,8 +97,9 @@
 #define RANDOM_HI_CHANCE           60   // Chance that a RANDOM Hi output illuminates its LED.
 #define RANDOM_LO_CHANCE           40   // Chance that a RANDOM Lo output illuminates its LED.
 
-#define PWM_TICK                   -1   // PWM tick adjustment to give maximum frequency to PWM signal.
-#define PWM_INC                  0x10   // Increment between pins to ensure even distribution.
+#define PWM_TIMER                  49   // Timer2 compare value, counting 2us (clk/32), so PWM ticks every 100us.
+#define PWM_TICK                    4   // PWM counter increment each tick, giving 64 levels at 156Hz.
+#define PWM_INC                  0x20   // Increment between pins to ensure even distribution.
 
 #define JUMPER_PINS                 4   // Four jumpers.
 #define IO_PINS                     8   // Eight IO pins.
@@ -87,6 +114,10 @@
 // Alternate pins that can be used to control the menus. First entry unused.
 const uint8_t BUTTON_PINS[] = { 0xff, A1, A2, A3, 2, 3 };
 
+// Consecutive scans (1 - 7) an Input must be in its new state before it's actioned.
+// For each Input type: Toggle, On_Off, On, Off.
+const uint8_t INPUT_DEBOUNCE[] = { 4, 3, 3, 3 };
+
 #else
 
 // The module jumper pins. 0xff means don't use.
@@ -24,7 +24,7 @@
 #else
     const char M_SOFTWARE[]     PROGMEM = "Output module";
 #endif
-const char M_VERSION[]          PROGMEM = "v3.5.1";        // See also system.VERSION.
+const char M_VERSION[]          PROGMEM = "v3.5.2";        // See also system.VERSION.
 const char M_VERSION_DATE[]     PROGMEM = "May 21";
 const char M_INIT_I2C[]         PROGMEM = "Init I2C";
 const char M_STARTUP[]          PROGMEM = "Startup";
@@ -37,6 +37,7 @@ const char M_SYSTEM[]           PROGMEM = "System";
 const char M_INPUT[]            PROGMEM = "Input";
 const char M_OUTPUT[]           PROGMEM = "Output";
 const char M_TYPES[]            PROGMEM = "Types";
+const char M_INDEX[]            PROGMEM = "Index";
 
 
 // Configuration - Output.
@@ -103,6 +104,8 @@ const char* const M_OUTPUT_TYPES[]   = { M_NONE,  M_SERVO,  M_SIGNAL, M_LED, M_L
     // Import/export actions.
     const char M_EXPORTING[]        PROGMEM = "Exporting";
     const char M_WAITING[]          PROGMEM = "Waiting";
+    const char M_ACK[]              PROGMEM = "ACK ";
+    const char M_NAK[]              PROGMEM = "NAK ";
 
 
     // Configuration - general.
@@ -113,6 +116,7 @@ const char* const M_OUTPUT_TYPES[]   = { M_NONE,  M_SERVO,  M_SIGNAL, M_LED, M_L
     const char M_EXPORT[]           PROGMEM = "Export";
     const char M_IMPORT[]           PROGMEM = "Import";
     const char M_ALL[]              PROGMEM = "All";
+    const char M_BACKUP[]           PROGMEM = "Backup";
 
     
     // Configuration - System.
@@ -151,7 +155,7 @@ const char* const M_OUTPUT_TYPES[]   = { M_NONE,  M_SERVO,  M_SIGNAL, M_LED, M_L
     const char* const M_BUTTONS[]        = { M_NONE, M_SELECT, M_LEFT, M_DOWN, M_UP, M_RIGHT };
     const char* const M_TOP_MENU[]       = { M_SYSTEM, M_INPUT, M_OUTPUT, M_LOCK, M_EXPORT, M_IMPORT };
     const char* const M_SYS_TYPES[]      = { M_REPORT, M_NODES, M_IDENT, M_DEBUG };
-    const char* const M_EXPORT_TYPES[]   = { M_ALL, M_SYSTEM, M_INPUT, M_OUTPUT, M_LOCK };
+    const char* const M_EXPORT_TYPES[]   = { M_ALL, M_SYSTEM, M_INPUT, M_OUTPUT, M_LOCK, M_BACKUP };
     const char* const M_REPORT_PROMPTS[] = { M_NONE, M_SHORT, M_LONG, M_PAUSE };
     const char* const M_DEBUG_PROMPTS[]  = { M_NONE, M_ERRORS, M_BRIEF, M_DETAIL, M_FULL };
     const char* const M_INPUT_TYPES[]    = { M_TOGGLE, M_ON_OFF, M_ON,  M_OFF };
@@ -161,6 +165,9 @@ const char* const M_OUTPUT_TYPES[]   = { M_NONE,  M_SERVO,  M_SIGNAL, M_LED, M_L
     
 // Common debug messages.
 
+const char M_DEBUG_ALL[]        PROGMEM = "All";
+const char M_DEBUG_BATCH[]      PROGMEM = "Batch";
+const char M_DEBUG_CAPS[]       PROGMEM = "Caps";
 const char M_DEBUG_DEBUG[]      PROGMEM = "Debug";
 const char M_DEBUG_LOAD[]       PROGMEM = "Load";
 const char M_DEBUG_MOVE[]       PROGMEM = "Move";
@@ -181,6 +188,7 @@ const char M_DEBUG_HI[]         PROGMEM = ", hi=";
 const char M_DEBUG_LO[]         PROGMEM = ", lo=";
 const char M_DEBUG_LOCK_HI[]    PROGMEM = ", lockHi=";
 const char M_DEBUG_LOCK_LO[]    PROGMEM = ", lockLo=";
+const char M_DEBUG_LOST[]       PROGMEM = ", lost=";
 const char M_DEBUG_NODE[]       PROGMEM = ", node=";
 const char M_DEBUG_PACE[]       PROGMEM = ", pace=";
 const char M_DEBUG_RESET_AT[]   PROGMEM = ", resetAt=";
@@ -191,15 +199,28 @@ const char M_DEBUG_TYPE[]       PROGMEM = ", type=";
 const char M_DEBUG_VALUE[]      PROGMEM = ", value=";
 
 const char* const M_DEBUG_COMMANDS[]   = { M_DEBUG_SYSTEM, M_DEBUG_DEBUG, M_DEBUG_SET_LO, M_DEBUG_SET_HI, M_DEBUG_READ, M_DEBUG_WRITE, M_DEBUG_SAVE, M_DEBUG_RESET,
-                                           M_RFU, M_RFU, M_RFU, M_RFU, M_RFU, M_RFU, M_RFU, M_NONE };
+                                           M_DEBUG_BATCH, M_DEBUG_ALL, M_RFU, M_RFU, M_RFU, M_RFU, M_RFU, M_NONE };
 
 #if MASTER
 
     // Master-only debug messages.
     const char M_DEBUG_BUTTON[]     PROGMEM = "Button";
-
+    const char M_DEBUG_CLEAR_BUS[]  PROGMEM = "ClearBus";
+    const char M_DEBUG_EVENT[]      PROGMEM = "Event";
+    const char M_DEBUG_HEALTH[]     PROGMEM = "Health";
+    const char M_DEBUG_STACK[]      PROGMEM = "Stack";
+
+    const char M_DEBUG_AGE[]        PROGMEM = ", age=";
+    const char M_DEBUG_CLEARS[]     PROGMEM = ", clears=";
+    const char M_DEBUG_ERRORS[]     PROGMEM = ", errors=";
+    const char M_DEBUG_HEADROOM[]   PROGMEM = ", headroom=";
+    const char M_DEBUG_HITS[]       PROGMEM = ", hits=";
+    const char M_DEBUG_MISSES[]     PROGMEM = ", misses=";
     const char M_DEBUG_OUTPUTS[]    PROGMEM = ", outputs=";
+    const char M_DEBUG_PEAK[]       PROGMEM = ", peak=";
     const char M_DEBUG_PIN[]        PROGMEM = ", pin=";
+    const char M_DEBUG_QUEUE[]      PROGMEM = ", queue=";
+    const char M_DEBUG_RETRIES[]    PROGMEM = ", retries=";
     const char M_DEBUG_RETURN[]     PROGMEM = ", ret=";
 
 #else
@@ -59,13 +59,74 @@ long    now       = 0;  // To keep the current time (since boot).
 long    tickServo = 0;  // Ticking for Servos.
 long    tickLed   = 0;  // Ticking for Leds.
 long    tickFlash = 0;  // Ticking for Flashers.
-uint8_t tickPwm   = 0;  // Ticking for PWM output of LEDs.
+volatile uint8_t tickPwm = 0;   // Level of the PWM table being output, only changed by the Timer2 interrupt.
 
 
-// i2c request command parameters
-uint8_t requestCommand = COMMS_CMD_NONE;
-uint8_t requestOption  = 0;
-uint8_t requestNode    = 0;
+// Ports and masks for the PWM output of LEDs, so the Timer2 interrupt can write the ports directly.
+#define PWM_PORTS   3                                   // PORTB, PORTC and PORTD.
+#define PWM_LEVELS  (256 / PWM_TICK)                    // Levels in each PWM cycle (must be a power of 2).
+
+uint8_t pwmSigPort[IO_PINS];                            // Index (PORTB, PORTC, PORTD) of each sigPins' port.
+uint8_t pwmSigMask[IO_PINS];                            // Bit mask of each sigPins in its port.
+uint8_t pwmIoPort[IO_PINS];                             // Index (PORTB, PORTC, PORTD) of each ioPins' port.
+uint8_t pwmIoMask[IO_PINS];                             // Bit mask of each ioPins in its port.
+
+volatile uint8_t pwmPins = 0;                           // Outputs driven by PWM, one bit per output.
+volatile uint8_t pwmMasks[PWM_PORTS] = { 0, 0, 0 };     // Bits of each port driven by PWM.
+
+uint8_t pwmTable[PWM_LEVELS][PWM_PORTS];                // Port bits to set at each level, built by loop() for the interrupt.
+uint8_t pwmValue[IO_PINS];                              // Each Output's value when its pwmTable bits were built.
+uint8_t pwmAltValue[IO_PINS];                           // Each Output's altValue when its pwmTable bits were built.
+
+
+// i2c request command parameters, set by loop() and answered by the request interrupt.
+volatile uint8_t requestCommand = COMMS_CMD_NONE;
+volatile uint8_t requestOption  = 0;
+volatile uint8_t requestNode    = 0;
+volatile boolean requestCaps    = false;    // Capabilities requested, answered without waiting for loop().
+
+// The last request answered, so loop() can report it.
+volatile boolean repliedRequest = false;
+volatile uint8_t repliedCommand = COMMS_CMD_NONE;
+volatile uint8_t repliedOption  = 0;
+
+
+// Queue of received frames, copied by the i2c interrupt and processed by loop().
+// Our address isn't acknowledged while the queue's nearly full, the last place is kept for a general call.
+#define RECEIPT_QUEUE_MAX   (COMMS_QUEUE_FREE + 2)      // Size of the queue, one entry is always empty.
+#define RECEIPT_FRAME_MAX   (1 + 2 * OUTPUT_BATCH_MAX)  // Largest frame, a batch.
+#define RECEIPT_HOLD_ID     0x7f                        // Reserved i2c address, used while holding off.
+
+struct
+{
+    uint8_t len;                                        // Length of the frame.
+    uint8_t data[RECEIPT_FRAME_MAX];                    // The command, and its data.
+} receipts[RECEIPT_QUEUE_MAX];
+
+volatile uint8_t receiptHead = 0;                       // Next frame to process, only changed by the consumer.
+volatile uint8_t receiptTail = 0;                       // Next frame to fill, only changed by the interrupt.
+volatile boolean receiptBusy = false;                   // loop() is processing frames.
+volatile uint8_t receiptLost = 0;                       // Number of frames lost because the queue was full.
+uint8_t          receiptAddress = 0;                    // Our i2c address register (TWAR) while holding off, zero if not.
+boolean          journalPending = false;                // The Outputs' states need saving in the journal.
+
+
+/** A Stream to read the frame being processed, as the commands would read Wire.
+ */
+class Receipt : public Stream
+{
+    public:
+
+    uint8_t* data = 0;      // The frame.
+    uint8_t  len  = 0;      // Its length.
+    uint8_t  pos  = 0;      // The next byte to read.
+
+    int    available()      { return len - pos; }
+    int    read()           { return pos < len ? data[pos++] : -1; }
+    int    peek()           { return pos < len ? data[pos]   : -1; }
+    size_t write(uint8_t)   { return 0; }
+    void   flush()          { }
+} receipt;
 
 
 // An Array of Output control structures.
@@ -99,6 +160,12 @@ void setup()
     {
         pinMode(sigPins[pin], OUTPUT);
         pinMode(ioPins[pin],  OUTPUT);
+
+        // Find each pin's port and mask so PWM can write the ports directly.
+        pwmSigPort[pin] = digitalPinToPort(sigPins[pin]) - PB;
+        pwmSigMask[pin] = digitalPinToBitMask(sigPins[pin]);
+        pwmIoPort[pin]  = digitalPinToPort(ioPins[pin])  - PB;
+        pwmIoMask[pin]  = digitalPinToBitMask(ioPins[pin]);
     }
 
     // Load SystemData from EEPROM and check it's valid.
@@ -109,6 +176,7 @@ void setup()
     else
     {
         // Recover state from EEPROM.
+        loadStateJournal();
         for (uint8_t pin = 0; pin < IO_PINS; pin++)
         {
             loadOutput(pin);
@@ -119,7 +187,8 @@ void setup()
 
     // Start i2c communications.
     Wire.begin(getModuleId(true));
-    Wire.onReceive(processReceipt);
+    enableGeneralCall();
+    Wire.onReceive(queueReceipt);
     Wire.onRequest(processRequest);
 
     // Flash out version number on the built-in LED,
@@ -129,6 +198,9 @@ void setup()
         flashVersion();
     }
 
+    // Start PWM of the LEDs now the version has been flashed.
+    startPwm();
+
     // Show system data (depending on debug level).
     debugSystemData();
 }
@@ -144,6 +216,7 @@ void firstRun()
     systemData.magic = MAGIC_NUMBER;
 
     // Initialise EEPROM with suitable data.
+    clearStateJournal();
     for (uint8_t pin = 0; pin < IO_PINS; pin++)
     {
         outputDefs[pin].setType(OUTPUT_TYPE_NONE);
@@ -218,6 +291,9 @@ void initOutput(uint8_t aPin, uint8_t aOldType)
     {
         reportOutput(M_DEBUG_INIT, aPin);
     }
+
+    // Drive the pins with PWM only if the Output is a LED.
+    setPwm(aPin);
         
     // Detach servo if currently attached and no longer required.
     if (   (isServo(aOldType))
@@ -341,6 +417,17 @@ void initFlasher(uint8_t aPin)
 }
 
 
+/** Enable receipt of general call (broadcast) messages.
+ *  Wire.begin() clears the enable, so call after it.
+ */
+void enableGeneralCall()
+{
+#ifdef TWGCE
+    TWAR |= _BV(TWGCE);
+#endif
+}
+
+
 /** Report unrecognised command.
  */
 void unrecognisedCommand(PGM_P aMessage, uint8_t aCommand, uint8_t aOption)
@@ -360,35 +447,44 @@ void unrecognisedCommand(PGM_P aMessage, uint8_t aCommand, uint8_t aOption)
 
 
 /** Process a Request (for data).
- *  Send data to master.
+ *  Send data to master, only from state loop() has finished with.
+ *  If loop() hasn't processed all the commands received, tell the master to ask again.
+ *  Capabilities have no status byte, so older masters (and modules) read them the same way.
  */
 void processRequest()
 {
-    if (isDebug(DEBUG_BRIEF))
+    if (requestCaps)
     {
-        Serial.println();
-        Serial.print(millis());
-        Serial.print(CHAR_TAB);
-        Serial.print(PGMT(M_DEBUG_REQUEST));
-        Serial.print(PGMT(M_DEBUG_COMMAND));
-        Serial.print(PGMT(M_DEBUG_COMMANDS[requestCommand >> COMMS_COMMAND_SHIFT]));
-        Serial.print(PGMT(M_DEBUG_OPTION));
-        Serial.print(requestOption, HEX);
-        Serial.println();
+        Wire.write(COMMS_CAPS);
+
+        repliedCommand = COMMS_CMD_SYSTEM;
+        repliedOption  = COMMS_SYS_CAPS;
+        repliedRequest = true;
+        requestCaps    = false;
     }
-    
-    switch (requestCommand)
+    else if (   (receiptBusy)
+             || (receiptHead != receiptTail))
     {
-        case COMMS_CMD_SYSTEM: returnSystem();
-                               break;
-        case COMMS_CMD_READ:   returnDef();
-                               break;
-        default:               unrecognisedCommand(M_DEBUG_REQUEST, requestCommand, requestOption);
-                               break;
+        Wire.write(COMMS_REPLY_BUSY);
     }
+    else
+    {
+        Wire.write(COMMS_REPLY_READY);
+        
+        switch (requestCommand)
+        {
+            case COMMS_CMD_SYSTEM: returnSystem();
+                                   break;
+            case COMMS_CMD_READ:   returnDef();
+                                   break;
+        }
 
-    // Clear pending command.
-    requestCommand = COMMS_CMD_NONE;
+        // Record the request for loop() to report, and clear pending command.
+        repliedCommand = requestCommand;
+        repliedOption  = requestOption;
+        repliedRequest = true;
+        requestCommand = COMMS_CMD_NONE;
+    }
 }
 
 
@@ -398,19 +494,17 @@ void returnSystem()
 {
     switch (requestOption)
     {
-        case COMMS_SYS_STATES:   returnStates();
+        case COMMS_SYS_STATES:   Wire.write(getStates());
                                  break;
         case COMMS_SYS_RENUMBER: returnRenumber();
                                  break;
-        default:                 unrecognisedCommand(M_DEBUG_SYSTEM, requestCommand, requestOption);
-                                 break;
     }
 }
 
 
-/** Return the state of all the node's Outputs.
+/** Get the state of all the node's Outputs.
  */
-void returnStates()
+uint8_t getStates()
 {
     uint8_t states = 0;
 
@@ -422,32 +516,21 @@ void returnStates()
             states |= mask;
         }
     }
-    
-    Wire.write(states);
 
-    if (isDebug(DEBUG_BRIEF))
-    {
-        Serial.print(millis());
-        Serial.print(CHAR_TAB);
-        Serial.print(PGMT(M_DEBUG_STATES));
-        Serial.print(CHAR_SPACE);
-        Serial.print(states, HEX);
-        Serial.println();
-    }
+    return states;
 }
 
 
 /** Return the result of a renumber request.
+ *  loop() has already saved the new module ID.
  */
 void returnRenumber()
 {
-    systemData.i2cModuleID = requestNode;
-    saveSystemData();
-
     Wire.write(getModuleId(false));
 
     // Now change our module ID.
-    Wire.begin(getModuleId(true));
+    Wire.begin(I2C_OUTPUT_BASE_ID + getModuleId(false));
+    enableGeneralCall();
 }
 
 
@@ -455,15 +538,166 @@ void returnRenumber()
  */
 void returnDef()
 {
-    if (isDebug(DEBUG_BRIEF))
+    outputDefs[requestOption].write();
+}
+
+
+/** Report the last request answered (depending on debug level).
+ */
+void reportRequest()
+{
+    uint8_t command = repliedCommand;
+    uint8_t option  = repliedOption;
+
+    repliedRequest = false;
+    
+    if (   (command != COMMS_CMD_SYSTEM)
+        && (command != COMMS_CMD_READ))
     {
-        outputDefs[requestOption].printDef(M_DEBUG_SEND, requestOption);
+        unrecognisedCommand(M_DEBUG_REQUEST, command, option);
+    }
+    else if (isDebug(DEBUG_BRIEF))
+    {
+        Serial.println();
+        Serial.print(millis());
+        Serial.print(CHAR_TAB);
+        Serial.print(PGMT(M_DEBUG_REQUEST));
+        Serial.print(PGMT(M_DEBUG_COMMAND));
+        Serial.print(PGMT(M_DEBUG_COMMANDS[command >> COMMS_COMMAND_SHIFT]));
+        Serial.print(PGMT(M_DEBUG_OPTION));
+        Serial.print(option, HEX);
+        Serial.println();
+
+        if (command == COMMS_CMD_READ)
+        {
+            outputDefs[option].printDef(M_DEBUG_SEND, option);
+        }
+        else if (option == COMMS_SYS_STATES)
+        {
+            Serial.print(millis());
+            Serial.print(CHAR_TAB);
+            Serial.print(PGMT(M_DEBUG_STATES));
+            Serial.print(CHAR_SPACE);
+            Serial.print(getStates(), HEX);
+            Serial.println();
+        }
+        else if (option == COMMS_SYS_CAPS)
+        {
+            Serial.print(millis());
+            Serial.print(CHAR_TAB);
+            Serial.print(PGMT(M_DEBUG_CAPS));
+            Serial.print(CHAR_SPACE);
+            Serial.print(COMMS_CAPS, HEX);
+            Serial.println();
+        }
+        else if (option == COMMS_SYS_RENUMBER)
+        {
+            getModuleId(true);      // Announces the new module ID.
+        }
     }
-    outputDefs[requestOption].write();
 }
 
 
 /** Data received.
+ *  Copy the frame to the queue for loop() to process, so the interrupt is brief.
+ *  Stop acknowledging our address once the queue's nearly full, so the master waits rather than frames being lost.
+ */
+void queueReceipt(int aLen)
+{
+    uint8_t tail = receiptTail;
+    uint8_t next = (tail + 1) % RECEIPT_QUEUE_MAX;
+
+    if (aLen == 0)
+    {
+        // Null receipt - Just the master seeing if we exist (or have room), nothing to process.
+    }
+    else if (   (aLen == 1)
+             && (Wire.peek() == (COMMS_CMD_SYSTEM | COMMS_SYS_CAPS)))
+    {
+        // Capabilities don't depend on the commands queued, so are answered straight away.
+        Wire.read();
+        requestCaps = true;
+    }
+    else if (next == receiptHead)
+    {
+        receiptLost += 1;       // Full (only possible with general calls).
+    }
+    else
+    {
+        receipts[tail].len = 0;
+        while (   (Wire.available())
+               && (receipts[tail].len < RECEIPT_FRAME_MAX))
+        {
+            receipts[tail].data[receipts[tail].len++] = Wire.read();
+        }
+        receiptTail = next;     // Publish the frame.
+
+        if (   (!receiptAddress)
+            && ((next + RECEIPT_QUEUE_MAX - receiptHead) % RECEIPT_QUEUE_MAX >= COMMS_QUEUE_FREE))
+        {
+            holdReceipts(true);
+        }
+    }
+
+    // Discard anything that didn't fit.
+    while (Wire.available())
+    {
+        Wire.read();
+    }
+}
+
+
+/** Process all the queued frames.
+ *  Requests are answered busy until this has finished, so responses reflect all the commands received before them.
+ */
+void processReceipts()
+{
+    receiptBusy = true;
+    
+    while (receiptHead != receiptTail)
+    {
+        receipt.data = receipts[receiptHead].data;
+        receipt.len  = receipts[receiptHead].len;
+        receipt.pos  = 0;
+        processReceipt(receipt.len);
+        
+        receiptHead = (receiptHead + 1) % RECEIPT_QUEUE_MAX;
+
+        // Room again, so acknowledge the master.
+        noInterrupts();
+        if (   (receiptAddress)
+            && ((receiptTail + RECEIPT_QUEUE_MAX - receiptHead) % RECEIPT_QUEUE_MAX < COMMS_QUEUE_FREE))
+        {
+            holdReceipts(false);
+        }
+        interrupts();
+    }
+
+    receiptBusy = false;
+}
+
+
+/** Stop (or start again) acknowledging our i2c address, while the receipt queue's nearly full.
+ *  General calls are still acknowledged.
+ */
+void holdReceipts(boolean aHold)
+{
+#ifdef TWGCE
+    if (aHold)
+    {
+        receiptAddress = TWAR;
+        TWAR = (RECEIPT_HOLD_ID << 1) | (receiptAddress & _BV(TWGCE));
+    }
+    else
+    {
+        TWAR = receiptAddress;
+        receiptAddress = 0;
+    }
+#endif
+}
+
+
+/** Process a received frame.
  *  Process the command.
  */
 void processReceipt(int aLen)
@@ -471,7 +705,7 @@ void processReceipt(int aLen)
     if (aLen > 0)
     {
         // Read the command byte.
-        uint8_t command = Wire.read();
+        uint8_t command = receipt.read();
         uint8_t option  = command & COMMS_OPTION_MASK;
         uint8_t pin     = option  & OUTPUT_PIN_MASK;
         uint8_t delay   = 0;
@@ -501,11 +735,16 @@ void processReceipt(int aLen)
                                    saveSystemData();
                                    break;
             case COMMS_CMD_SET_LO:  
-            case COMMS_CMD_SET_HI: if (Wire.available())
+            case COMMS_CMD_SET_HI: if (receipt.available())
                                    {
-                                       delay = Wire.read();         // Optional delay value.
+                                       delay = receipt.read();         // Optional delay value.
                                    }
                                    actionState(pin, command == COMMS_CMD_SET_HI, delay, false);
+                                   if (option & COMMS_SET_REPORT)
+                                   {
+                                       requestCommand = COMMS_CMD_SYSTEM;   // Master will read our states.
+                                       requestOption  = COMMS_SYS_STATES;
+                                   }
                                    break;
             case COMMS_CMD_READ:   requestCommand = command;        // Record the command.
                                    requestOption  = option;         // and the pin the master wants to read.
@@ -516,28 +755,17 @@ void processReceipt(int aLen)
                                    break;
             case COMMS_CMD_RESET:  processReset(pin);               // Reset the Output.
                                    break;
+            case COMMS_CMD_BATCH:  processBatch(option);            // Option is the number of Outputs.
+                                   break;
+            case COMMS_CMD_ALL:    processAll(option);              // Option is the all sub-command.
+                                   break;
             default:               unrecognisedCommand(M_DEBUG_RECEIPT, command, option);
                                    break;
         }
     }
-    else
-    {
-        // Null receipt - Just the master seeing if we exist.
-        if (isDebug(DEBUG_BRIEF))
-        {
-            Serial.println();
-            Serial.print(millis());
-            Serial.print(CHAR_TAB);
-            Serial.print(PGMT(M_DEBUG_RECEIPT));
-            Serial.print(CHAR_SPACE);
-            Serial.print(PGMT(M_DEBUG_LEN));
-            Serial.print(aLen, HEX);
-            Serial.println();
-        }
-    }
     
     // Consume unexpected data.
-    if (Wire.available())
+    if (receipt.available())
     {
         if (isDebug(DEBUG_ERRORS))
         {
@@ -546,13 +774,13 @@ void processReceipt(int aLen)
             Serial.print(CHAR_TAB);
             Serial.print(PGMT(M_DEBUG_UNEXPECTED));
             Serial.print(PGMT(M_DEBUG_LEN));
-            Serial.print(Wire.available(), HEX);
+            Serial.print(receipt.available(), HEX);
             Serial.print(CHAR_COLON);
         }
         
-        while (Wire.available())
+        while (receipt.available())
         {
-            uint8_t ch = Wire.read();
+            uint8_t ch = receipt.read();
             if (isDebug(DEBUG_ERRORS))
             {
                 Serial.print(CHAR_SPACE);
@@ -592,9 +820,13 @@ void processSystem(uint8_t aOption)
  */
 void processRenumber()
 {
-    if (Wire.available())
+    if (receipt.available())
     {
-        requestNode = Wire.read();      // The desired new node number.
+        requestNode = receipt.read();      // The desired new node number.
+
+        // Save it now, the request is answered (with the new number) by the interrupt.
+        systemData.i2cModuleID = requestNode;
+        saveSystemData();
     }
     else
     {
@@ -608,12 +840,12 @@ void processRenumber()
             Serial.print(PGMT(M_DEBUG_OPTION));
             Serial.print(requestOption);
             Serial.print(PGMT(M_DEBUG_LEN));
-            Serial.print(Wire.available());
+            Serial.print(receipt.available());
             Serial.println();
         }
         
         // Revoke the request so it can't be actioned.
-        requestCommand == COMMS_CMD_NONE;
+        requestCommand = COMMS_CMD_NONE;
     }
 }
 
@@ -622,11 +854,11 @@ void processRenumber()
  */
 void processMoveLocks()
 {
-    if (Wire.available() != OUTPUT_MOVE_LOCK_LEN)
+    if (receipt.available() != OUTPUT_MOVE_LOCK_LEN)
     {
         // Read the old and new node numbers.
-        uint8_t oldNode = Wire.read() & OUTPUT_NODE_MASK;
-        uint8_t newNode = Wire.read() & OUTPUT_NODE_MASK;
+        uint8_t oldNode = receipt.read() & OUTPUT_NODE_MASK;
+        uint8_t newNode = receipt.read() & OUTPUT_NODE_MASK;
 
         if (isDebug(DEBUG_DETAIL))
         {
@@ -671,7 +903,7 @@ void processMoveLocks()
             Serial.print(PGMT(M_DEBUG_COMMAND));
             Serial.print(PGMT(M_DEBUG_MOVE));
             Serial.print(PGMT(M_DEBUG_LEN));
-            Serial.print(Wire.available());
+            Serial.print(receipt.available());
             Serial.println();
         }
     }
@@ -686,7 +918,7 @@ void processWrite(uint8_t aPin)
 {
     uint8_t oldType = outputDefs[aPin].getType();       // Remember old type.
     
-    if (Wire.available() < OUTPUT_SIZE)
+    if (receipt.available() < OUTPUT_SIZE)
     {
         if (isDebug(DEBUG_ERRORS))
         {
@@ -695,14 +927,14 @@ void processWrite(uint8_t aPin)
             Serial.print(PGMT(M_DEBUG_WRITE));
             Serial.print(aPin, HEX);
             Serial.print(PGMT(M_DEBUG_LEN));
-            Serial.print(Wire.available(), HEX);
+            Serial.print(receipt.available(), HEX);
             Serial.println();
         }
     }
     else
     {
         persisting = false;             // Stop saving state to EEPROM.
-        outputDefs[aPin].read();        // Read the Output definition.
+        outputDefs[aPin].read(receipt); // Read the Output definition.
         initOutput(aPin, oldType);      // Initialise the pin.
 
         if (isDebug(DEBUG_BRIEF))
@@ -721,6 +953,7 @@ void processSave(uint8_t aPin)
     
     persisting = true;              // Resume saving output to EEPROM.
     saveOutput(aPin);               // And save the output.
+    journalPending = true;          // And its state.
     initOutput(aPin, oldType);      // Ensure output is initialised to new state.
     initFlasher(aPin);              // Ensure flasher is operating (or not).
 }
@@ -739,6 +972,51 @@ void processReset(uint8_t aPin)
 }
 
 
+/** Process a batch of state changes.
+ *  Action them all together, then return our states to the master.
+ */
+void processBatch(uint8_t aCount)
+{
+    for (uint8_t index = 0; index < aCount; index++)
+    {
+        if (receipt.available() >= 2)
+        {
+            uint8_t pinState = receipt.read();
+            uint8_t delay    = receipt.read();
+            
+            actionState(pinState & OUTPUT_PIN_MASK, (pinState & OUTPUT_STATE_MASK) != 0, delay, false);
+        }
+    }
+
+    requestCommand = COMMS_CMD_SYSTEM;      // Master will read our states.
+    requestOption  = COMMS_SYS_STATES;
+}
+
+
+/** Process a command for all the Outputs.
+ */
+void processAll(uint8_t aOption)
+{
+    for (uint8_t pin = 0; pin < OUTPUT_PIN_MAX; pin++)
+    {
+        if (outputDefs[pin].getType() != OUTPUT_TYPE_NONE)
+        {
+            switch (aOption)
+            {
+                case COMMS_ALL_LO:    actionState(pin, false, 0, false);
+                                      break;
+                case COMMS_ALL_HI:    actionState(pin, true,  0, false);
+                                      break;
+                case COMMS_ALL_RESET: processReset(pin);
+                                      break;
+                default:              unrecognisedCommand(M_DEBUG_ALL, COMMS_CMD_ALL, aOption);
+                                      return;
+            }
+        }
+    }
+}
+
+
 /** Action the state change against the specified pin.
  *  Delay for aDelay seconds.
  *  If a Servo, and aUseValue is set, use its current position rather than Lo-Hi when calculating range of movement.
@@ -808,10 +1086,10 @@ void actionState(uint8_t aPin, boolean aState, uint8_t aDelay, boolean aUseValue
         // Set the Output to the new state.
         outputDefs[aPin].setState(newState);
         
-        // Save the new state if persisting is enabled.
+        // Save the new state if persisting is enabled (by loop()).
         if (persisting)
         {
-            saveOutput(aPin);
+            journalPending = true;
         }
     
         if (isDebug(DEBUG_DETAIL))
@@ -973,10 +1251,10 @@ boolean actionDoubleLed(uint8_t aPin, boolean aState)
             outputs[aPin].altTarget = 0;
         }
         
-        // Save the new state if persisting is enabled.
+        // Save the new state if persisting is enabled (by loop()).
         if (persisting)
         {
-            saveOutput(ledPin);
+            journalPending = true;
         }
     }
 
@@ -1429,6 +1707,116 @@ void stepFlash(uint8_t aPin)
 }
 
 
+/** Start the Timer2 interrupt that generates the PWM signal for the LEDs.
+ */
+void startPwm()
+{
+    noInterrupts();
+    TCCR2A = _BV(WGM21);                // CTC mode, count up to OCR2A.
+    TCCR2B = _BV(CS21) | _BV(CS20);     // clk/32.
+    OCR2A  = PWM_TIMER;
+    TCNT2  = 0;
+    TIMSK2 = _BV(OCIE2A);               // Interrupt on compare match.
+    interrupts();
+}
+
+
+/** Include (or exclude) an Output's pins in the PWM signal, depending on its type.
+ *  Excluded pins are left alone by the interrupt, so can be used for Servos.
+ */
+void setPwm(uint8_t aPin)
+{
+    uint8_t mask = 1 << aPin;
+
+    noInterrupts();
+    if (   (outputDefs[aPin].isLed())
+        || (outputDefs[aPin].isFlasher()))
+    {
+        pwmPins                     |= mask;
+        buildPwm(aPin);
+        pwmMasks[pwmSigPort[aPin]]  |= pwmSigMask[aPin];
+        pwmMasks[pwmIoPort[aPin]]   |= pwmIoMask[aPin];
+    }
+    else
+    {
+        pwmPins                     &= ~mask;
+        pwmMasks[pwmSigPort[aPin]]  &= ~pwmSigMask[aPin];
+        pwmMasks[pwmIoPort[aPin]]   &= ~pwmIoMask[aPin];
+        buildPwm(aPin);
+    }
+    interrupts();
+}
+
+
+/** Build an Output's bits in every level of the PWM table from its value/altValue.
+ *  Outputs not driven by PWM have their bits cleared.
+ */
+void buildPwm(uint8_t aPin)
+{
+    boolean isPwm = (pwmPins & (1 << aPin)) != 0;
+    uint8_t value = isPwm ? outputs[aPin].value    : 0;
+    uint8_t alt   = isPwm ? outputs[aPin].altValue : 0;
+    uint8_t tick  = aPin * PWM_INC;
+
+    for (uint8_t level = 0; level < PWM_LEVELS; level++, tick += PWM_TICK)
+    {
+        uint8_t* on = pwmTable[level];
+
+        on[pwmSigPort[aPin]] &= ~pwmSigMask[aPin];
+        on[pwmIoPort[aPin]]  &= ~pwmIoMask[aPin];
+
+        // Use compliment of tick for alt pin to remove the chance of both being on at once.
+        if (   (value >  0)
+            && (value >= tick))
+        {
+            on[pwmSigPort[aPin]] |= pwmSigMask[aPin];
+        }
+        if (   (alt   >  0)
+            && (alt   >= (uint8_t)~tick))
+        {
+            on[pwmIoPort[aPin]]  |= pwmIoMask[aPin];
+        }
+    }
+
+    pwmValue[aPin]    = value;
+    pwmAltValue[aPin] = alt;
+}
+
+
+/** Rebuild the PWM table for any LED Outputs whose value/altValue has changed.
+ */
+void updatePwm()
+{
+    uint8_t mask = 1;
+
+    for (uint8_t pin = 0; pin < IO_PINS; pin++, mask <<= 1)
+    {
+        if (   (pwmPins & mask)
+            && (   (outputs[pin].value    != pwmValue[pin])
+                || (outputs[pin].altValue != pwmAltValue[pin])))
+        {
+            buildPwm(pin);
+        }
+    }
+}
+
+
+/** Timer2 interrupt, output the next level of the PWM table.
+ *  Kept minimal (no loops) so it doesn't delay the Servo interrupt's pulses.
+ *  Each port is written once, only changing the bits driven by PWM.
+ */
+ISR(TIMER2_COMPA_vect)
+{
+    const uint8_t* on = pwmTable[tickPwm];
+
+    PORTB = (PORTB & ~pwmMasks[0]) | on[0];
+    PORTC = (PORTC & ~pwmMasks[1]) | on[1];
+    PORTD = (PORTD & ~pwmMasks[2]) | on[2];
+
+    tickPwm = (tickPwm + 1) & (PWM_LEVELS - 1);
+}
+
+
 //// Metrics.
 //long start = 0;
 //long count = 0;
@@ -1442,6 +1830,36 @@ void loop()
 {
     // Record the time now
     now = millis();
+
+    // Process the commands received.
+    processReceipts();
+
+    // Save the Outputs' states, after the commands so their replies aren't held up.
+    if (journalPending)
+    {
+        journalPending = false;
+        saveStateJournal();
+    }
+
+    if (   (receiptLost > 0)
+        && (isDebug(DEBUG_ERRORS)))
+    {
+        Serial.print(millis());
+        Serial.print(CHAR_TAB);
+        Serial.print(PGMT(M_DEBUG_RECEIPT));
+        Serial.print(PGMT(M_DEBUG_LOST));
+        Serial.print(receiptLost);
+        Serial.println();
+        receiptLost = 0;
+    }
+
+    if (repliedRequest)
+    {
+        reportRequest();
+    }
+
+    // Keep the PWM table in step with the LEDs' values.
+    updatePwm();
     
 //  // Metrics
 //  count += 1;
@@ -1491,38 +1909,4 @@ void loop()
         tickFlash = now + STEP_FLASH;
         stepFlashes();
     }
-
-    // Set LED Outputs based on their intensity value/alt, using the ticker to generate a PWM signal.
-    tickPwm += PWM_TICK;
-    for (uint8_t pin = 0; pin < IO_PINS; pin++)
-    {
-        tickPwm += PWM_INC;
-        if (   (outputDefs[pin].isLed())
-            || (outputDefs[pin].isFlasher()))
-        {
-            // Use compliment of tickPwm for alt pin to remove the chance of both being on at once.
-            digitalWrite(sigPins[pin],    (outputs[pin].value    >  0)
-                                       && (outputs[pin].value    >= ( tickPwm & 0xff)));
-            digitalWrite(ioPins[pin],     (outputs[pin].altValue >  0)
-                                       && (outputs[pin].altValue >= (~tickPwm & 0xff)));
-        }
-//        // Example how to use PORTS to toggle pins directly.
-//        // See OUTPUT_BASE_PIN and ioPins for output => pin mapping.
-//        // PORTD - Arduino digital pins 0 -  7
-//        // PORTB - Arduino digital pins 8 - 13
-//        // PORTC - Arduino analog  pins 0 -  7.
-//        // Servo pin 3 is Arduino pin 7 which is PORTD mask 0x80
-//        if (pin == 3)
-//        {
-//            if (   outputs[pin].value    >  0 
-//                && outputs[pin].value    >= ( nowMicros & 0xff))
-//            {
-//                PORTD |= 0x80;
-//            }
-//            else
-//            {
-//                PORTD &= 0x7f;
-//            }
-//        }
-    }
 }
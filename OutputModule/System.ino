@@ -378,4 +378,9 @@ void dumpMemory()
     Serial.println();
 #endif
 
+#if INDEX_BASE
+    dumpMemory(M_INDEX,  INDEX_BASE,  INDEX_END);
+    Serial.println();
+#endif
+
 }
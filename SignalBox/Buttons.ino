@@ -61,7 +61,7 @@ void calibrateButtons()
         // Wait for a button to be pressed
         while ((value = analogRead(A0)) > BUTTON_THRESHHOLD)
         {
-            delay(DELAY_BUTTON_WAIT);
+            delayOperating(DELAY_BUTTON_WAIT);
         }
 
         if (isDebug(DEBUG_ERRORS))
@@ -83,14 +83,14 @@ void calibrateButtons()
         // Wait for button to be released.
         while (analogRead(A0) < BUTTON_THRESHHOLD)
         {
-            delay(DELAY_BUTTON_WAIT);
+            delayOperating(DELAY_BUTTON_WAIT);
         }
 
         // Check for buttons out-of-sequence
         if (previous < value)
         {
             disp.printProgStrAt(LCD_COL_START, LCD_ROW_DET, M_SEQUENCE, LCD_COLS);
-            delay(DELAY_READ);
+            delayOperating(DELAY_READ);
 
             // Force start again.
             button = -1;
@@ -121,6 +121,9 @@ uint8_t readButton()
     uint8_t button = BUTTON_NONE;
     int     value  = analogRead(BUTTON_ANALOG);
 
+    // Send some of the display's changes while waiting for buttons.
+    disp.flush(LCD2_FLUSH_MAX);
+
 //    static int previous = 0;
 //    if (value != previous)
 //    {
@@ -181,11 +184,11 @@ void waitForButtonRelease()
 {
     do
     {
-        delay(DELAY_BUTTON_WAIT);
+        delayOperating(DELAY_BUTTON_WAIT);
     }
     while (readButton() != BUTTON_NONE);
 
-    delay(DELAY_BUTTON_WAIT);
+    delayOperating(DELAY_BUTTON_WAIT);
 }
 
 
@@ -200,7 +203,7 @@ uint8_t waitForButtonPress()
     waitForButtonRelease();
     while ((button = readButton()) == BUTTON_NONE)
     {
-        delay(DELAY_BUTTON_WAIT);
+        delayOperating(DELAY_BUTTON_WAIT);
     }
     
     return button;
@@ -222,7 +225,7 @@ uint8_t waitForButtonClick()
     while (   ((button = readButton()) == BUTTON_NONE)
            && (millis() < delayTo))
     {
-        delay(DELAY_BUTTON_WAIT);
+        delayOperating(DELAY_BUTTON_WAIT);
     }
     
     waitForButtonRelease();
@@ -16,8 +16,20 @@
  *  This is achieved by the master sending a write message indicating what's required,
  *  and then immediately issuing a read i2c message to read the response from the Output module.
  *  
+ *  Modules with COMMS_CAP_STATUS queue the commands they receive and process them in their loop(),
+ *  so their responses start with a status byte. They reply COMMS_REPLY_BUSY (and nothing else) until
+ *  they have processed all the commands received, the master then asks again, see COMMS_BUSY_POLLS.
+ *  Older modules' responses have no status byte. Nor does the CAPS response, so it's read the same from all modules.
+ *  
+ *  While its queue is nearly full, a module with COMMS_CAP_STATUS stops acknowledging its address
+ *  (keeping the last place for a general call). So the master never sends more than COMMS_QUEUE_FREE
+ *  commands without reading a response, without first checking the module acknowledges, see COMMS_HOLD_POLLS.
+ *  
+ *  Commands without a response may also be sent to the i2c general call address (I2C_BROADCAST_ID),
+ *  and are then actioned by all the Output modules that support COMMS_CAP_BROADCAST.
+ *  
  *  Basic message:      <CommandByte><Data byte>...
- *  Optional response:  <Response byte>...
+ *  Optional response:  <Status byte><Response byte>...
  *  
  *  Command byte:   7 6 5 4   3 2 1 0
  *                  Command   Option
@@ -32,10 +44,17 @@
  *      SYSTEM  STATES                              <PinStatus>
  *      SYSTEM  RENUMBER    <NewNode>               <NewNode>
  *      SYSTEM  MOVE_LOCKS  <OldNode>   <NewNode>
+ *      SYSTEM  CAPS                                <Caps>
  *      
  *      DEBUG   <Level>
  *      SET_LO  <Pin>       [Delay]
  *      SET_HI  <Pin>       [Delay]
+ *      SET_LO  <Pin>|REPORT [Delay]                <PinStatus>
+ *      SET_HI  <Pin>|REPORT [Delay]                <PinStatus>
+ *      BATCH   <Count>     <PinState> <Delay>...   <PinStatus>
+ *      ALL     LO
+ *      ALL     HI
+ *      ALL     RESET
  *      
  *      READ    <Pin>                               <OutputDef>
  *      WRITE   <Pin>       <OutputDef>
@@ -50,10 +69,15 @@
  *      Level       The debug level to set (0-4). See DEBUG_... flags.
  *      Pin         The pin (0-7) to action the command against.
  *      Delay       Optional delay (in seconds, 0-255) before actioning the command.
+ *      Count       The number (1-15) of PinState and Delay pairs that follow, all actioned together.
+ *      PinState    The pin (0-7) in the bottom 3 bits, and the state to set it to in the top bit (set = "Hi"). See OUTPUT_STATE_MASK.
  *      OutputDef   15 bytes defining an output. See below.
  *      
  * Response bytes
+ *      Status      COMMS_REPLY_READY followed by the response, or COMMS_REPLY_BUSY. Only from modules with COMMS_CAP_STATUS.
  *      PinStatus   The current status of all output pins. Pin 0 in bit 0, to Pin 7 in bit 7. Bit set = pin is "Hi".
+ *      Caps        The optional commands the output module supports. See COMMS_CAP_... flags. Never has a status byte,
+ *                  older modules (that don't recognise the command) return zero.
  *      NewNode     The new node number (0-31) of the output module.
  *      OldNode     The old node number (0-31) of the output module.
  *      OutputDef   15 bytes defining an output. See below.
@@ -90,6 +114,8 @@
 #define COMMS_CMD_WRITE         0x50    // Write data to Output's EEPROM definition (from the i2c master).
 #define COMMS_CMD_SAVE          0x60    // Write data to Output's EEPROM definition and save it.
 #define COMMS_CMD_RESET         0x70    // Reset output to its saved state (from its EEPROM).
+#define COMMS_CMD_BATCH         0x80    // Set the states of several outputs at once.
+#define COMMS_CMD_ALL           0x90    // Action all outputs (normally broadcast).
 
 #define COMMS_CMD_NONE          0xff    // Null command.
 
@@ -98,6 +124,33 @@
 #define COMMS_SYS_STATES        0x00    // System states sub-command.
 #define COMMS_SYS_RENUMBER      0x01    // System renumber node sub-command.
 #define COMMS_SYS_MOVE_LOCKS    0x02    // System renumber lock node numbers.
+#define COMMS_SYS_CAPS          0x03    // System capabilities sub-command.
+
+
+// All sub-commands (in bottom nibble).
+#define COMMS_ALL_LO            0x00    // Set all outputs Lo.
+#define COMMS_ALL_HI            0x01    // Set all outputs Hi.
+#define COMMS_ALL_RESET         0x02    // Reset all outputs to their saved states.
+
+
+// Set options (in bottom nibble, with the pin).
+#define COMMS_SET_REPORT        0x08    // Return the node's states after actioning the command.
+
+
+// Response status, the first byte of every response (except CAPS) from modules with COMMS_CAP_STATUS.
+#define COMMS_REPLY_READY       0x5a    // The response follows.
+#define COMMS_REPLY_BUSY        0xa5    // Still processing earlier commands, ask again.
+
+#define COMMS_QUEUE_FREE           2    // Commands a module with COMMS_CAP_STATUS can always queue.
+
+
+// Capabilities, returned by COMMS_SYS_CAPS.
+#define COMMS_CAP_STATES        0x01    // Supports COMMS_SET_REPORT.
+#define COMMS_CAP_BATCH         0x02    // Supports COMMS_CMD_BATCH.
+#define COMMS_CAP_BROADCAST     0x04    // Receives general calls, and supports COMMS_CMD_ALL.
+#define COMMS_CAP_STATUS        0x08    // Queues commands, and starts responses with a status byte.
+
+#define COMMS_CAPS              (COMMS_CAP_STATES | COMMS_CAP_BATCH | COMMS_CAP_BROADCAST | COMMS_CAP_STATUS)  // This version's capabilities.
 
 
 #endif
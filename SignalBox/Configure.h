@@ -726,7 +726,7 @@ class Configure
                                         // Handle (rare) case where output node has failed (and this is first time we noticed).
                                         if (!isOutputNodePresent(outNode))
                                         {
-                                            delay(DELAY_READ);      // Time to read error message.
+                                            delayOperating(DELAY_READ);      // Time to read error message.
                                             displayAll();           // Recover display.
                                             finished = true;        // Abort.
                                         }
@@ -811,11 +811,14 @@ class Configure
         waitForButtonRelease();
         
         // Scan all the input nodes until a button is pressed.
+        // The layout keeps operating, but doesn't scan the Inputs, so their changes are seen here.
+        selecting = true;
         while ((button = readButton()) == BUTTON_NONE)
         {
             scanInputs(true);
-            delay(DELAY_BUTTON_WAIT);
+            delayOperating(DELAY_BUTTON_WAIT);
         }
+        selecting = false;
 
         // If operation cancelled, revert to original input.
         if (button != BUTTON_SELECT)
@@ -920,13 +923,19 @@ class Configure
     uint8_t renumberNode(uint8_t aOldNode, uint8_t aNewNode)
     {
         int response = aOldNode;
+        int status   = -1;
 
         // Send the renumber command to the node concerned.
-        Wire.beginTransmission(I2C_OUTPUT_BASE_ID + aOldNode);
+        beginOutputTransmission(aOldNode);
         Wire.write(COMMS_CMD_SYSTEM | COMMS_SYS_RENUMBER);
         Wire.write(aNewNode);
-        if (   ((response = Wire.endTransmission()) == 0)
-            && ((response = Wire.requestFrom(I2C_OUTPUT_BASE_ID + outNode, OUTPUT_RENUMBER_LEN)) == OUTPUT_RENUMBER_LEN)
+        if ((response = Wire.endTransmission()) == 0)
+        {
+            // The module saves its new number before it responds (and changes its address), so wait for it.
+            status = waitOutputResponse(aOldNode, OUTPUT_RENUMBER_LEN);
+        }
+
+        if (   (status == COMMS_REPLY_READY)
             && ((response = Wire.read()) >= 0))
         {
             response &= OUTPUT_NODE_MASK;       // The new node number of the Output as returned by the node
@@ -954,6 +963,13 @@ class Configure
                 setOutputStates(aOldNode, getOutputStates(response));
                 setOutputStates(response, oldStates);
 
+                // And the capabilities.
+                uint8_t oldCaps = outputCaps[aOldNode];
+                outputCaps[aOldNode] = outputCaps[response];
+                outputCaps[response] = oldCaps;
+                outputQueued[aOldNode] = 0;
+                outputQueued[response] = 0;
+
                 // Show work as Inputs are updated.
                 disp.clearRow(LCD_COL_START, LCD_ROW_DET);
                 disp.printProgStrAt(LCD_COL_START, LCD_ROW_TOP, M_RENUMBER);
@@ -961,6 +977,8 @@ class Configure
                 disp.setCursor(-INPUT_NODE_MAX, LCD_ROW_DET);
                 
                 // Renumber all the effected inputs' Output nodes.
+                // Only the Input nodes that the index says drive the old Output node.
+                uint8_t indexed = getIndexedInputNodes(aOldNode);
                 for (uint8_t node = 0; node < INPUT_NODE_MAX; node++)
                 {
                     if (isInputNodePresent(node))
@@ -972,24 +990,27 @@ class Configure
                         disp.printCh(CHAR_DOT);
                     }
 
-                    // For all the Input's pins.
-                    for (uint8_t pin = 0; pin < INPUT_PIN_MAX; pin++)
+                    // For all the Input's pins, if any of them drive the old node.
+                    if (indexed & (1 << node))
                     {
-                        boolean changed = false;
-                        loadInput(node, pin);
-
-                        // Adjust all the Input's Outputs if they referencethe old node number.
-                        for (uint8_t index = 0; index < INPUT_OUTPUT_MAX; index++)
+                        for (uint8_t pin = 0; pin < INPUT_PIN_MAX; pin++)
                         {
-                            if (inputDef.getOutputNode(index) == aOldNode)
+                            boolean changed = false;
+                            loadInput(node, pin);
+
+                            // Adjust all the Input's Outputs if they referencethe old node number.
+                            for (uint8_t index = 0; index < INPUT_OUTPUT_MAX; index++)
                             {
-                                inputDef.setOutputNode(index, response);
-                                changed = true;
+                                if (inputDef.getOutputNode(index) == aOldNode)
+                                {
+                                    inputDef.setOutputNode(index, response);
+                                    changed = true;
+                                }
+                            }
+                            if (changed)
+                            {
+                                saveInput();
                             }
-                        }
-                        if (changed)
-                        {
-                            saveInput();
                         }
                     }
                 }
@@ -1025,11 +1046,13 @@ class Configure
                             Serial.println();    
                         }
             
-                        Wire.beginTransmission(I2C_OUTPUT_BASE_ID + node);
+                        beginOutputTransmission(node);
                         Wire.write(COMMS_CMD_SYSTEM | COMMS_SYS_MOVE_LOCKS);
                         Wire.write(aOldNode);
                         Wire.write(response);
-                        Wire.endTransmission();
+                        endOutputTransmission(node);
+
+                        invalidateOutputLocks(node);
                     }
                     else
                     {
@@ -1111,7 +1134,7 @@ class Configure
                                         testOutput();
                                         
                                         // A short delay to prevent over-loading output module, then ensure output is reset.
-                                        delay(DELAY_BUTTON_DELAY);
+                                        delayOperating(DELAY_BUTTON_DELAY);
                                         resetOutput();
                                     }
                                     break;
@@ -1366,8 +1389,10 @@ class Configure
         readOutput(inputDef.getOutput(aIndex));
         currentState = outputDef.getState();
         processInputOutput(aIndex, !currentState, 0);
+        sendOutputBatch();
         waitForButtonRelease();
         processInputOutput(aIndex,  currentState, 0);
+        sendOutputBatch();
     }
 
 
@@ -1488,7 +1513,7 @@ class Configure
         while (   ((button = readButton()) == BUTTON_NONE)
                && (millis() < endAt))
         {
-            delay(DELAY_BUTTON_WAIT);
+            delayOperating(DELAY_BUTTON_WAIT);
         }
 
         return button;
@@ -1617,7 +1642,7 @@ class Configure
                                         }
                                         disp.printDecAt(LCD_COL_OUTPUT_LO, LCD_ROW_BOT, outputDef.getLo(), OUTPUT_HI_LO_SIZE);
                                         writeOutput();
-                                        delay(autoRepeat);
+                                        delayOperating(autoRepeat);
                                         autoRepeat = DELAY_BUTTON_REPEAT;
                                     }
                                     while (readButton() != 0);
@@ -1632,7 +1657,7 @@ class Configure
                                         }
                                         disp.printDecAt(LCD_COL_OUTPUT_LO, LCD_ROW_BOT, outputDef.getLo(), OUTPUT_HI_LO_SIZE);
                                         writeOutput();
-                                        delay(autoRepeat);
+                                        delayOperating(autoRepeat);
                                         autoRepeat = DELAY_BUTTON_REPEAT;
                                     }
                                     while (readButton() != 0);
@@ -1685,7 +1710,7 @@ class Configure
                                         }
                                         disp.printDecAt(LCD_COL_OUTPUT_HI, LCD_ROW_BOT, outputDef.getHi(), OUTPUT_HI_LO_SIZE);
                                         writeOutput();
-                                        delay(autoRepeat);
+                                        delayOperating(autoRepeat);
                                         autoRepeat = DELAY_BUTTON_REPEAT;
                                     }
                                     while (readButton() != 0);
@@ -1700,7 +1725,7 @@ class Configure
                                         }
                                         disp.printDecAt(LCD_COL_OUTPUT_HI, LCD_ROW_BOT, outputDef.getHi(), OUTPUT_HI_LO_SIZE);
                                         writeOutput();
-                                        delay(autoRepeat);
+                                        delayOperating(autoRepeat);
                                         autoRepeat = DELAY_BUTTON_REPEAT;
                                     }
                                     while (readButton() != 0);
@@ -1791,7 +1816,7 @@ class Configure
                                     {
                                         outputDef.setReset(outputDef.getReset() + 1);
                                         disp.printDecAt(LCD_COL_OUTPUT_HI, LCD_ROW_BOT, outputDef.getReset(), OUTPUT_HI_LO_SIZE);
-                                        delay(autoRepeat);
+                                        delayOperating(autoRepeat);
                                         autoRepeat = DELAY_BUTTON_REPEAT;
                                     }
                                     while (readButton() != 0);
@@ -1802,7 +1827,7 @@ class Configure
                                     {
                                         outputDef.setReset(outputDef.getReset() - 1);
                                         disp.printDecAt(LCD_COL_OUTPUT_HI, LCD_ROW_BOT, outputDef.getReset(), OUTPUT_HI_LO_SIZE);
-                                        delay(autoRepeat);
+                                        delayOperating(autoRepeat);
                                         autoRepeat = DELAY_BUTTON_REPEAT;
                                     }
                                     while (readButton() != 0);
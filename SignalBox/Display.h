@@ -23,6 +23,8 @@
 #define LCD_ROWS              2   // by 2 rows.
 #define LCD2_COLS            20   // I2C Display is 20 columns
 #define LCD2_ROWS             4   // by 4 rows.
+#define LCD2_CELLS           (LCD2_COLS * LCD2_ROWS)    // Number of characters on the I2C Display.
+#define LCD2_FLUSH_MAX       20   // Most characters sent to the I2C Display by each flush.
 
 
 #define LCD_ROW_TOP           0   // Rows for Display state messages.
@@ -89,6 +91,45 @@ class Display
 #endif
     uint8_t            lcdId = 0;   // The ID of the i2c LCD. Never set if no i2c LCD.
 
+    // Framebuffer for the i2c LCD, only changed characters are sent to it.
+    char     lcd2Buffer[LCD2_ROWS][LCD2_COLS];  // The characters that should be showing.
+    uint32_t lcd2Dirty[LCD2_ROWS];              // A bit for each column that's yet to be sent.
+    uint8_t  lcd2Col  = 0;                      // Cursor in the framebuffer.
+    uint8_t  lcd2Row  = 0;
+    uint8_t  sentCol  = 0;                      // Cursor on the i2c LCD itself.
+    uint8_t  sentRow  = 0;
+
+
+    /** Put a character in the i2c LCD's framebuffer at the cursor.
+     *  Mark it to be sent if it's changed. Characters beyond the end of the row are lost.
+     */
+    void bufferCh(char aChar)
+    {
+        if (   (lcd2Col < LCD2_COLS)
+            && (lcd2Row < LCD2_ROWS))
+        {
+            if (lcd2Buffer[lcd2Row][lcd2Col] != aChar)
+            {
+                lcd2Buffer[lcd2Row][lcd2Col] = aChar;
+                lcd2Dirty[lcd2Row] |= 1UL << lcd2Col;
+            }
+            lcd2Col += 1;
+        }
+    }
+
+
+    /** Fill the i2c LCD's framebuffer with spaces, as the i2c LCD is when cleared.
+     */
+    void clearBuffer()
+    {
+        memset(lcd2Buffer, CHAR_SPACE, sizeof(lcd2Buffer));
+        memset(lcd2Dirty,  0,          sizeof(lcd2Dirty));
+        lcd2Col = 0;
+        lcd2Row = 0;
+        sentCol = 0;
+        sentRow = 0;
+    }
+
     
     public:
     
@@ -117,6 +158,8 @@ class Display
         lcdI2C->begin(LCD2_COLS, LCD2_ROWS);
         lcdI2C->backlight();
         lcdI2C->createChar(CHAR_LO, BYTES_LO);      
+        lcdI2C->clear();
+        clearBuffer();
     }
 #endif
 
@@ -140,6 +183,43 @@ class Display
         if (lcdI2C)
         {
             lcdI2C->clear();
+            clearBuffer();
+        }
+    }
+
+
+    /** Send changed characters from the framebuffer to the i2c LCD.
+     *  At most aBudget characters, so the i2c bus isn't hogged.
+     */
+    void flush(uint8_t aBudget)
+    {
+        if (lcdI2C)
+        {
+            for (uint8_t row = 0; row < LCD2_ROWS; row++)
+            {
+                for (uint8_t col = 0; (lcd2Dirty[row]) && (col < LCD2_COLS); col++)
+                {
+                    if (lcd2Dirty[row] & (1UL << col))
+                    {
+                        if (aBudget == 0)
+                        {
+                            return;
+                        }
+                        aBudget -= 1;
+
+                        // Only move the cursor if it isn't already there.
+                        if (   (col != sentCol)
+                            || (row != sentRow))
+                        {
+                            lcdI2C->setCursor(col, row);
+                            sentRow = row;
+                        }
+                        lcdI2C->print(lcd2Buffer[row][col]);
+                        sentCol = col + 1;
+                        lcd2Dirty[row] &= ~(1UL << col);
+                    }
+                }
+            }
         }
     }
 
@@ -154,33 +234,26 @@ class Display
         {
             // Position relative to the end of the row.
             lcdShield.setCursor(aCol + LCD_COLS, aRow & LCD_ROW_MASK);
-            if (lcdI2C)
-            {
-                lcdI2C->setCursor(aCol + LCD2_COLS, aRow);
-            }
+            lcd2Col = aCol + LCD2_COLS;
+            lcd2Row = aRow;
         }
         else
         {
             // Position relative to the start of the row.
             lcdShield.setCursor(aCol, aRow & LCD_ROW_MASK);
-            if (lcdI2C)
-            {
-                lcdI2C->setCursor(aCol, aRow);
-            }
+            lcd2Col = aCol;
+            lcd2Row = aRow;
         }
     }
     
 
     /** Prints a character on the LCD.
-     *  Delegate to library class.
+     *  Delegate to library class, the i2c LCD is updated by flush().
      */
     void printCh(char aChar)
     {
         lcdShield.print(aChar);
-        if (lcdI2C)
-        {
-            lcdI2C->print(aChar);
-        }
+        bufferCh(aChar);
     }
 
 
@@ -199,9 +272,9 @@ class Display
     void printStr(char* aString)
     {
         lcdShield.print(aString);
-        if (lcdI2C)
+        for (char* ch = aString; *ch; ch++)
         {
-            lcdI2C->print(aString);
+            bufferCh(*ch);
         }
     }
 
@@ -211,10 +284,12 @@ class Display
      */
     void printProgStr(PGM_P aMessagePtr)
     {
+        char ch;
+        
         lcdShield.print(PGMT(aMessagePtr));
-        if (lcdI2C)
+        for (PGM_P ptr = aMessagePtr; (ch = pgm_read_byte(ptr)); ptr++)
         {
-            lcdI2C->print(PGMT(aMessagePtr));
+            bufferCh(ch);
         }
     }
 
@@ -372,12 +447,11 @@ class Display
         }
 
         // Add extra spaces for lcdI2C if necessary.
-        if (   (lcdI2C)
-            && (aCol >= 0))
+        if (aCol >= 0)
         {
             for (uint8_t spaces = LCD_COLS; spaces < LCD2_COLS; spaces++)
             {
-                lcdI2C->print(CHAR_SPACE);
+                bufferCh(CHAR_SPACE);
             }
         }
     }
@@ -0,0 +1,65 @@
+/** I2C health.
+ *
+ *
+ *  (c)Copyright Tony Clulow  2021    tony.clulow@pentadtech.com
+ *
+ *  This work is licensed under the:
+ *      Creative Commons Attribution-NonCommercial-ShareAlike 4.0 International License.
+ *      http://creativecommons.org/licenses/by-nc-sa/4.0/
+ *
+ *  For commercial use, please contact the original copyright holder(s) to agree licensing terms
+ */
+ 
+#ifndef Health_h
+#define Health_h
+
+
+// Nodes monitored, Input nodes then Output nodes.
+#define HEALTH_MAX              (INPUT_NODE_MAX + OUTPUT_NODE_MAX)
+#define HEALTH_INPUT(node)      (node)                      // Health index of an Input node.
+#define HEALTH_OUTPUT(node)     (INPUT_NODE_MAX + (node))   // Health index of an Output node.
+
+#define HEALTH_CLEAR_CLOCKS     9       // Clock pulses to release a slave holding SDA low.
+#define HEALTH_CLEAR_DELAY      5       // Microsecs for each half of a bus clear clock pulse.
+
+
+uint8_t  healthErrors[HEALTH_MAX];      // Leaky count of each node's recent errors.
+uint16_t healthRetries = 0;             // Number of transactions that have been retried.
+uint16_t healthClears  = 0;             // Number of times the bus has been cleared.
+
+
+/** Initialise the i2c bus.
+ *  Set a timeout so a stuck bus can't hang Wire.
+ */
+void initHealth();
+
+
+/** Prepare to retry a failed transaction.
+ *  Clear the bus if it's stuck, then back off (for longer on each attempt).
+ */
+void retryHealth(uint8_t aAttempt);
+
+
+/** Record a successful transaction with a node.
+ */
+void recordHealthOk(uint8_t aIndex);
+
+
+/** Record a failed transaction with a node.
+ *  Return true if the node has had too many errors and should be taken offline.
+ */
+boolean recordHealthError(uint8_t aIndex);
+
+
+/** Forget a node's errors.
+ */
+void resetHealth(uint8_t aIndex);
+
+
+/** Clear a stuck i2c bus.
+ *  Clock SCL until any slave releases SDA, send a stop, then restart Wire.
+ */
+void clearBus();
+
+
+#endif
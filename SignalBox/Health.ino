@@ -0,0 +1,146 @@
+/** I2C health.
+ *
+ *
+ *  (c)Copyright Tony Clulow  2021    tony.clulow@pentadtech.com
+ *
+ *  This work is licensed under the:
+ *      Creative Commons Attribution-NonCommercial-ShareAlike 4.0 International License.
+ *      http://creativecommons.org/licenses/by-nc-sa/4.0/
+ *
+ *  For commercial use, please contact the original copyright holder(s) to agree licensing terms
+ */
+
+#include "All.h"
+
+
+/** Initialise the i2c bus.
+ *  Set a timeout so a stuck bus can't hang Wire.
+ */
+void initHealth()
+{
+    Wire.begin(I2C_CONTROLLER_ID);
+
+#if defined(WIRE_HAS_TIMEOUT)
+    Wire.setWireTimeout(HEALTH_WIRE_TIMEOUT, false);
+#endif
+}
+
+
+/** Prepare to retry a failed transaction.
+ *  Clear the bus if it's stuck, then back off (for longer on each attempt).
+ *  Just a brief delay, this is called part way through transactions so mustn't operate the layout.
+ */
+void retryHealth(uint8_t aAttempt)
+{
+    boolean stuck = !digitalRead(SDA);      // A slave is holding the bus.
+
+    healthRetries += 1;
+
+#if defined(WIRE_HAS_TIMEOUT)
+    if (Wire.getWireTimeoutFlag())
+    {
+        Wire.clearWireTimeoutFlag();
+        stuck = true;                       // A transaction timed out.
+    }
+#endif
+
+    if (stuck)
+    {
+        clearBus();
+    }
+
+    delay(HEALTH_BACKOFF << aAttempt);
+}
+
+
+/** Record a successful transaction with a node.
+ */
+void recordHealthOk(uint8_t aIndex)
+{
+    if (healthErrors[aIndex] > 0)
+    {
+        healthErrors[aIndex] -= 1;
+    }
+}
+
+
+/** Record a failed transaction with a node.
+ *  Return true if the node has had too many errors and should be taken offline.
+ */
+boolean recordHealthError(uint8_t aIndex)
+{
+    if (healthErrors[aIndex] < HEALTH_ERROR_LIMIT)
+    {
+        healthErrors[aIndex] += HEALTH_ERROR_WEIGHT;
+    }
+
+    if (isDebug(DEBUG_ERRORS))
+    {
+        Serial.print(millis());
+        Serial.print(CHAR_TAB);
+        Serial.print(PGMT(M_DEBUG_HEALTH));
+        Serial.print(CHAR_SPACE);
+        Serial.print(aIndex, HEX);
+        Serial.print(PGMT(M_DEBUG_ERRORS));
+        Serial.print(healthErrors[aIndex]);
+        Serial.print(PGMT(M_DEBUG_RETRIES));
+        Serial.print(healthRetries);
+        Serial.print(PGMT(M_DEBUG_CLEARS));
+        Serial.print(healthClears);
+        Serial.println();
+    }
+
+    return healthErrors[aIndex] >= HEALTH_ERROR_LIMIT;
+}
+
+
+/** Forget a node's errors.
+ */
+void resetHealth(uint8_t aIndex)
+{
+    healthErrors[aIndex] = 0;
+}
+
+
+/** Clear a stuck i2c bus.
+ *  Clock SCL until any slave releases SDA, send a stop, then restart Wire.
+ */
+void clearBus()
+{
+    healthClears += 1;
+    Wire.end();
+
+    // Release both lines, pulled up.
+    pinMode(SDA, INPUT_PULLUP);
+    pinMode(SCL, INPUT_PULLUP);
+    delayMicroseconds(HEALTH_CLEAR_DELAY);
+
+    // Clock SCL (by pulling it low) until the slave lets go of SDA.
+    for (uint8_t clock = 0; (clock < HEALTH_CLEAR_CLOCKS) && (!digitalRead(SDA)); clock++)
+    {
+        pinMode(SCL, OUTPUT);
+        digitalWrite(SCL, LOW);
+        delayMicroseconds(HEALTH_CLEAR_DELAY);
+        pinMode(SCL, INPUT_PULLUP);
+        delayMicroseconds(HEALTH_CLEAR_DELAY);
+    }
+
+    // Send a stop, SDA going high while SCL is high.
+    pinMode(SDA, OUTPUT);
+    digitalWrite(SDA, LOW);
+    delayMicroseconds(HEALTH_CLEAR_DELAY);
+    pinMode(SDA, INPUT_PULLUP);
+    delayMicroseconds(HEALTH_CLEAR_DELAY);
+
+    if (isDebug(DEBUG_ERRORS))
+    {
+        Serial.print(millis());
+        Serial.print(CHAR_TAB);
+        Serial.print(PGMT(M_DEBUG_CLEAR_BUS));
+        Serial.print(PGMT(M_DEBUG_CLEARS));
+        Serial.print(healthClears);
+        Serial.println();
+    }
+
+    initHealth();
+}
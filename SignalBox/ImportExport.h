@@ -13,16 +13,34 @@
 #ifndef ImportExport_h
 #define ImportExport_h
 
+#include <util/crc16.h>
+
 // Import word buffer.
 #define WORD_BUFFER_LENGTH  32
 
+// Import line buffer, so the next line can arrive while this one is imported. Only on the stack while importing.
+#define LINE_BUFFER_LENGTH  80
+
 // Export menu states.
 #define EXP_ALL      0
 #define EXP_SYSTEM   1
 #define EXP_INPUTS   2
 #define EXP_OUTPUTS  3
 #define EXP_LOCKS    4
-#define EXP_MAX      5
+#define EXP_BACKUP   5
+#define EXP_MAX      6
+
+// Binary backup blocks: BACKUP_MARK, type, index, length, data[length], CRC (hi, lo).
+// The CRC (CCITT) covers the type, index, length and data.
+#define BACKUP_MARK       0xb5  // Starts every block, never the start of a text line.
+#define BACKUP_LAYOUT      'L'  // The EEPROM and Output layout the backup was taken from, always the first block.
+#define BACKUP_EEPROM      'E'  // A block of the master's EEPROM, index is the block number.
+#define BACKUP_OUTPUT      'O'  // An Output's definition, index is the Output number (node and pin).
+#define BACKUP_END         'Z'  // End of the backup, no data.
+#define BACKUP_BLOCK_MAX    32  // Most data in a block.
+#define BACKUP_CRC_INIT 0xffff  // Initial value of a block's CRC.
+#define BACKUP_FORMAT        1  // Format of the backup, first byte of the layout block.
+#define BACKUP_LAYOUT_LEN    8  // Length of the layout block.
  
 
 /** An Importer/exporter.
@@ -31,9 +49,17 @@ class ImportExport
 {
     private:
     
-    int  lastChar;                              // Last character read.
-    char wordBuffer[WORD_BUFFER_LENGTH + 1];    // Buffer to read characters with null terminator on the end.
-    long messageTick = 1L;                      // Time the last message was emitted.
+    int      lastChar;                          // Last character read.
+    char     wordBuffer[WORD_BUFFER_LENGTH + 1];// Buffer to read characters with null terminator on the end.
+    char    *lineBuffer   = NULL;               // The line being imported (LINE_BUFFER_LENGTH), only while importing.
+    uint8_t  lineLen      = 0;                  // Length of the line.
+    uint8_t  linePos      = 0;                  // Next character of the line to read.
+    uint16_t lineCount    = 0;                  // Number of lines read.
+    boolean  lineRefused  = false;              // The line has been refused (NAK).
+    boolean  lineOverflow = false;              // The line was too long for the lineBuffer.
+    uint16_t blockCrc     = 0;                  // CRC of the backup block being sent or received.
+    boolean  blockLayout  = false;              // The backup being restored has the same layout as this software.
+    long     messageTick  = 1L;                 // Time the last message was emitted.
 
 
     /** Import a line.
@@ -248,16 +274,58 @@ class ImportExport
     }
 
 
-    /** Read a character into lastChar when available.
-     *  Abandon reading if a button is pressed.
+    /** Read a line from the Serial into the lineBuffer.
+     *  Abandon reading if a button is pressed, returning false.
      *  Output Waiting message if we wait a long time.
+     *  Characters beyond the end of the lineBuffer are lost, and the line's marked as overflowing.
      */
-    int readChar()
+    boolean readLine()
     {
-        while (   (!readButton())
-               && (!Serial.available()))
+        int ch = 0;
+
+        lineLen      = 0;
+        linePos      = 0;
+        lineOverflow = false;
+        
+        while (ch != CHAR_NEWLINE)
         {
-            delay(DELAY_BUTTON_WAIT);
+            if (!waitForSerial())
+            {
+                return false;
+            }
+
+            ch = Serial.read();
+            if (lineLen < LINE_BUFFER_LENGTH)
+            {
+                lineBuffer[lineLen++] = ch;
+            }
+            else if (ch != CHAR_NEWLINE)
+            {
+                lineOverflow = true;
+            }
+        }
+
+        lineCount += 1;
+        lastChar   = CHAR_SPACE;
+        
+        return true;
+    }
+
+
+    /** Wait for a character to be available from the Serial.
+     *  Abandon waiting if a button is pressed, returning false.
+     *  Output Waiting message if we wait a long time.
+     */
+    boolean waitForSerial()
+    {
+        while (!Serial.available())
+        {
+            if (readButton())
+            {
+                return false;
+            }
+            
+            delayOperating(DELAY_BUTTON_WAIT);
 
             // Clear message if there's no activity.
             if (   (messageTick > 0)
@@ -270,7 +338,27 @@ class ImportExport
             }
         }
 
-        return Serial.read();
+        return true;
+    }
+
+
+    /** Acknowledge (ACK) or refuse (NAK) the line.
+     *  The importer sends the next line when it sees this.
+     */
+    void ackLine(boolean aOk)
+    {
+        Serial.print(PGMT(aOk ? M_ACK : M_NAK));
+        Serial.print(lineCount);
+        Serial.println();
+    }
+
+
+    /** Read the line's next character.
+     *  End-of-line once the line is exhausted.
+     */
+    int readChar()
+    {
+        return linePos < lineLen ? lineBuffer[linePos++] : CHAR_NEWLINE;
     }
     
     
@@ -383,6 +471,10 @@ class ImportExport
      */
     void importError()
     {
+        // Refuse the line, so the importer knows before waiting for the user.
+        ackLine(false);
+        lineRefused = true;
+        
         // Report unrecognised import line.
         disp.clearRow(LCD_COL_START, LCD_ROW_DET);
         disp.setCursor(LCD_COL_START, LCD_ROW_DET);
@@ -402,6 +494,209 @@ class ImportExport
     }
 
 
+    /** Send a byte of a backup block, adding it to the block's CRC.
+     */
+    void sendBlockByte(uint8_t aByte)
+    {
+        Serial.write(aByte);
+        blockCrc = _crc_ccitt_update(blockCrc, aByte);
+    }
+
+
+    /** Send a backup block.
+     */
+    void sendBlock(uint8_t aType, uint8_t aIndex, uint8_t* aData, uint8_t aLength)
+    {
+        Serial.write(BACKUP_MARK);
+        blockCrc = BACKUP_CRC_INIT;
+        sendBlockByte(aType);
+        sendBlockByte(aIndex);
+        sendBlockByte(aLength);
+        for (uint8_t index = 0; index < aLength; index++)
+        {
+            sendBlockByte(aData[index]);
+        }
+
+        Serial.write(blockCrc >> 8);
+        Serial.write(blockCrc & 0xff);
+    }
+
+
+    /** Get the layout of the EEPROM and Outputs, so a backup is only restored to the same layout.
+     */
+    void getBackupLayout(uint8_t* aData)
+    {
+        aData[0] = BACKUP_FORMAT;
+        aData[1] = INPUT_BASE  >> 8;
+        aData[2] = INPUT_BASE  & 0xff;
+        aData[3] = INDEX_BASE  >> 8;
+        aData[4] = INDEX_BASE  & 0xff;
+        aData[5] = EEPROM_END  >> 8;
+        aData[6] = EEPROM_END  & 0xff;
+        aData[7] = sizeof(OutputDef);
+    }
+
+
+    /** Export a binary backup.
+     *  The layout, the master's EEPROM image, then the definitions of all the Outputs of every Output node present.
+     */
+    void exportBackup()
+    {
+        uint8_t data[BACKUP_BLOCK_MAX];
+        uint8_t block = 0;
+
+        getBackupLayout(data);
+        sendBlock(BACKUP_LAYOUT, 0, data, BACKUP_LAYOUT_LEN);
+
+        for (int base = 0; base < EEPROM_END; base += BACKUP_BLOCK_MAX)
+        {
+            uint8_t length = min(BACKUP_BLOCK_MAX, EEPROM_END - base);
+            
+            for (uint8_t index = 0; index < length; index++)
+            {
+                data[index] = EEPROM.read(base + index);
+            }
+            sendBlock(BACKUP_EEPROM, block++, data, length);
+        }
+
+        for (uint8_t node = 0; node < OUTPUT_NODE_MAX; node++)
+        {
+            if (isOutputNodePresent(node))
+            {
+                for (uint8_t pin = 0; pin < OUTPUT_PIN_MAX; pin++)
+                {
+                    readOutput(node, pin);
+                    sendBlock(BACKUP_OUTPUT, (node << OUTPUT_NODE_SHIFT) | pin, (uint8_t*)&outputDef, sizeof(OutputDef));
+                }
+            }
+        }
+
+        sendBlock(BACKUP_END, 0, data, 0);
+    }
+
+
+    /** Read a byte of a backup block, adding it to the block's CRC.
+     *  Return a negative number if abandoned.
+     */
+    int readBlockByte()
+    {
+        int value = -1;
+
+        if (waitForSerial())
+        {
+            value    = Serial.read();
+            blockCrc = _crc_ccitt_update(blockCrc, value);
+        }
+
+        return value;
+    }
+
+
+    /** Import (restore) a backup block.
+     *  Acknowledge (ACK) it if it's intact and restored, else refuse it (NAK).
+     *  Blocks are refused unless the backup's layout block matches this software's layout.
+     */
+    void importBlock()
+    {
+        uint8_t  data[BACKUP_BLOCK_MAX];
+        uint8_t  layout[BACKUP_LAYOUT_LEN];
+        int      type   = 0;
+        int      index  = 0;
+        int      length = 0;
+        int      value  = 0;
+        uint16_t crc    = 0;
+        boolean  ok     = false;
+
+        Serial.read();                      // BACKUP_MARK
+        lineCount += 1;
+        
+        blockCrc = BACKUP_CRC_INIT;
+        type     = readBlockByte();
+        index    = readBlockByte();
+        length   = readBlockByte();
+        if (   (index  < 0)
+            || (length < 0)
+            || (length > BACKUP_BLOCK_MAX))
+        {
+            length = -1;
+        }
+        else
+        {
+            for (uint8_t pos = 0; pos < length; pos++)
+            {
+                if ((value = readBlockByte()) < 0)
+                {
+                    length = -1;
+                    break;
+                }
+                data[pos] = value;
+            }
+        }
+
+        // Check the block is intact, then restore it.
+        crc = blockCrc;
+        if (   (length >= 0)
+            && (waitForSerial())
+            && (Serial.read() == (crc >> 8))
+            && (waitForSerial())
+            && (Serial.read() == (crc & 0xff)))
+        {
+            ok = blockLayout;
+            switch (type)
+            {
+                case BACKUP_LAYOUT: getBackupLayout(layout);
+                                    ok = blockLayout =    (length == BACKUP_LAYOUT_LEN)
+                                                       && (!memcmp(data, layout, BACKUP_LAYOUT_LEN));
+                                    break;
+                case BACKUP_EEPROM: if (   (ok)
+                                        && (index * BACKUP_BLOCK_MAX + length <= EEPROM_END))
+                                    {
+                                        for (uint8_t pos = 0; pos < length; pos++)
+                                        {
+                                            EEPROM.update(index * BACKUP_BLOCK_MAX + pos, data[pos]);
+                                        }
+                                    }
+                                    else
+                                    {
+                                        ok = false;
+                                    }
+                                    break;
+                case BACKUP_OUTPUT: outputNode = (index >> OUTPUT_NODE_SHIFT) & OUTPUT_NODE_MASK;
+                                    outputPin  = (index                     ) & OUTPUT_PIN_MASK;
+                                    if (   (ok)
+                                        && (length == sizeof(OutputDef))
+                                        && (isOutputNodePresent(outputNode)))
+                                    {
+                                        memcpy(&outputDef, data, sizeof(OutputDef));
+                                        writeOutput();
+                                        writeSaveOutput();
+                                    }
+                                    else
+                                    {
+                                        ok = false;
+                                    }
+                                    break;
+                case BACKUP_END:    if (ok)
+                                    {
+                                        loadSystemData();       // Pick up the restored EEPROM.
+                                        initInputCache();
+                                    }
+                                    blockLayout = false;
+                                    break;
+                default:            ok = false;
+                                    break;
+            }
+
+            disp.printProgStrAt(LCD_COLS - LCD_LEN_OPTION, LCD_ROW_TOP, M_BACKUP, LCD_LEN_OPTION);
+            disp.clearRow(LCD_COL_START, LCD_ROW_DET);
+            disp.printChAt(LCD_COL_START, LCD_ROW_DET, type);
+            disp.printHexByteAt(LCD_COL_NODE, LCD_ROW_DET, index);
+        }
+
+        ackLine(ok);
+    }
+
+
     /** Export the system parameters.
      */
     void exportSystem(uint8_t aDebugLevel)
@@ -492,13 +787,44 @@ class ImportExport
     }
     
     
+    /** Export the Outputs' header comment.
+     */
+    void exportOutputsHeader()
+    {
+        Serial.print(PGMT(M_EXPORT_OUTPUT));
+        Serial.println();
+    }
+
+
+    /** Export an Output's definition (already read into outputDef).
+     */
+    void exportOutput(uint8_t aNode, uint8_t aPin)
+    {
+        Serial.print(PGMT(M_OUTPUT));
+        Serial.print(CHAR_TAB);
+        Serial.print(HEX_CHARS[aNode]);
+        Serial.print(CHAR_TAB);
+        Serial.print(HEX_CHARS[aPin]);
+        Serial.print(CHAR_TAB);
+        Serial.print(PGMT(M_OUTPUT_TYPES[outputDef.getType()]));
+        Serial.print(CHAR_TAB);
+        printHex(outputDef.getLo(),    2);
+        Serial.print(CHAR_TAB);
+        printHex(outputDef.getHi(),    2);
+        Serial.print(CHAR_TAB);
+        printHex(outputDef.getPace(),  2);
+        Serial.print(CHAR_TAB);
+        printHex(outputDef.getReset(), 2);
+        Serial.println();
+    }
+
+
     /** Export the Outputs.
      */
     void exportOutputs()
     {
         // Export header comment.
-        Serial.print(PGMT(M_EXPORT_OUTPUT));
-        Serial.println();
+        exportOutputsHeader();
 
         // Export all the Outputs.
         for (int node = 0; node < OUTPUT_NODE_MAX; node++)
@@ -509,23 +835,7 @@ class ImportExport
                 {
                     // Export Output definition.
                     readOutput(node, pin);
-    
-                    Serial.print(PGMT(M_OUTPUT));
-                    Serial.print(CHAR_TAB);
-                    Serial.print(HEX_CHARS[node]);
-                    Serial.print(CHAR_TAB);
-                    Serial.print(HEX_CHARS[pin]);
-                    Serial.print(CHAR_TAB);
-                    Serial.print(PGMT(M_OUTPUT_TYPES[outputDef.getType()]));
-                    Serial.print(CHAR_TAB);
-                    printHex(outputDef.getLo(),    2);
-                    Serial.print(CHAR_TAB);
-                    printHex(outputDef.getHi(),    2);
-                    Serial.print(CHAR_TAB);
-                    printHex(outputDef.getPace(),  2);
-                    Serial.print(CHAR_TAB);
-                    printHex(outputDef.getReset(), 2);
-                    Serial.println();
+                    exportOutput(node, pin);
                 }
                 Serial.println();
             }
@@ -533,11 +843,10 @@ class ImportExport
     }
 
 
-    /** Export the defined locks.
+    /** Export the locks' header comment.
      */
-    void exportLocks(boolean aAll)
+    void exportLocksHeader()
     {
-        // Export header comment.
         Serial.print(PGMT(M_EXPORT_LOCKS));
 
         // Export the Lo and Hi lock header comments.
@@ -551,6 +860,50 @@ class ImportExport
             }
         }
         Serial.println();
+    }
+
+
+    /** Export an Output's locks (already read into outputDef).
+     */
+    void exportLock(uint8_t aNode, uint8_t aPin)
+    {
+        Serial.print(PGMT(M_LOCK));
+        Serial.print(CHAR_TAB);
+        Serial.print(HEX_CHARS[aNode]);
+        Serial.print(CHAR_TAB);
+        Serial.print(HEX_CHARS[aPin]);
+
+        // Export locks, Lo and Hi
+        for (uint8_t hi = 0; hi < 2; hi++)
+        {
+            for (uint8_t index = 0; index < OUTPUT_LOCK_MAX; index++)
+            {
+                // Export a lock.
+                Serial.print(CHAR_TAB);
+                if (outputDef.isLock(hi, index))
+                {
+                    Serial.print(PGMT(outputDef.getLockState(hi, index) ? M_HI : M_LO));
+                    Serial.print(CHAR_SPACE);
+                    Serial.print(HEX_CHARS[outputDef.getLockNode(hi, index)]);
+                    Serial.print(CHAR_SPACE);
+                    Serial.print(HEX_CHARS[outputDef.getLockPin (hi, index)]);
+                }
+                else
+                {
+                    Serial.print(CHAR_DOT);
+                }
+            }
+        }
+        Serial.println();
+    }
+
+
+    /** Export the defined locks.
+     */
+    void exportLocks(boolean aAll)
+    {
+        // Export header comment.
+        exportLocksHeader();
 
         // Export all the locks.
         for (int node = 0; node < OUTPUT_NODE_MAX; node++)
@@ -561,35 +914,33 @@ class ImportExport
                 {
                     // Export a lock definition.
                     readOutput(node, pin);
+                    exportLock(node, pin);
+                }
+                Serial.println();
+            }
+        }
+    }
 
-                    Serial.print(PGMT(M_LOCK));
-                    Serial.print(CHAR_TAB);
-                    Serial.print(HEX_CHARS[node]);
-                    Serial.print(CHAR_TAB);
-                    Serial.print(HEX_CHARS[pin]);
 
-                    // Export locks, Lo and Hi
-                    for (uint8_t hi = 0; hi < 2; hi++)
-                    {
-                        for (uint8_t index = 0; index < OUTPUT_LOCK_MAX; index++)
-                        {
-                            // Export a lock.
-                            Serial.print(CHAR_TAB);
-                            if (outputDef.isLock(hi, index))
-                            {
-                                Serial.print(PGMT(outputDef.getLockState(hi, index) ? M_HI : M_LO));
-                                Serial.print(CHAR_SPACE);
-                                Serial.print(HEX_CHARS[outputDef.getLockNode(hi, index)]);
-                                Serial.print(CHAR_SPACE);
-                                Serial.print(HEX_CHARS[outputDef.getLockPin (hi, index)]);
-                            }
-                            else
-                            {
-                                Serial.print(CHAR_DOT);
-                            }
-                        }
-                    }
-                    Serial.println();
+    /** Export the Outputs and their locks, reading each Output only once.
+     *  Each Output is followed by its locks (so they import in the right order).
+     */
+    void exportOutputsLocks()
+    {
+        // Export header comments.
+        exportOutputsHeader();
+        exportLocksHeader();
+
+        for (int node = 0; node < OUTPUT_NODE_MAX; node++)
+        {
+            if (isOutputNodePresent(node))
+            {
+                for (int pin = 0; pin < OUTPUT_PIN_MAX; pin++)
+                {
+                    // Export Output definition and its locks.
+                    readOutput(node, pin);
+                    exportOutput(node, pin);
+                    exportLock(node, pin);
                 }
                 Serial.println();
             }
@@ -607,12 +958,18 @@ class ImportExport
 
 
     /** Import configuration from Serial line.
+     *  Each line is read whole, then acknowledged (ACK) or refused (NAK) once it's imported.
+     *  So the importer can send the next line whilst this one is imported.
      */
     void doImport()
     {
-        int len = 0;
+        int  len = 0;
+        char line[LINE_BUFFER_LENGTH];
         
+        lineBuffer  = line;
         messageTick = 1;            // Ensure "waiting" message appears.
+        lineCount   = 0;
+        blockLayout = false;        // A backup must start with its layout.
         waitForButtonRelease();
     
         // Clear the buffer
@@ -622,19 +979,48 @@ class ImportExport
         }
 
         // Keep going until until button pressed.
-        while (   ((len = readWord()) >= 0)
+        while (   (waitForSerial())
                && (!readButton()))
         {
+            // A binary backup block.
+            if (Serial.peek() == BACKUP_MARK)
+            {
+                importBlock();
+                messageTick = millis() + DELAY_READ;
+                continue;
+            }
+
+            if (!readLine())
+            {
+                break;
+            }
+            
+            lineRefused = false;
+            len = readWord();
             if (   (len > 0)
                 && (wordBuffer[0] != CHAR_HASH))
             {
-                importLine();
+                if (lineOverflow)
+                {
+                    importError();                  // Truncated, so don't import it.
+                }
+                else
+                {
+                    importLine();
+                }
                 messageTick = millis() + DELAY_READ;
             }
 
             // Skip rest of line.
             skipLine();
+
+            if (!lineRefused)
+            {
+                ackLine(true);
+            }
         }
+
+        lineBuffer = NULL;
     }
     
     
@@ -651,8 +1037,7 @@ class ImportExport
         {
             case EXP_ALL:     exportSystem(debugLevel >= DEBUG_FULL);
                               exportInputs(true);
-                              exportOutputs();
-                              exportLocks(true);
+                              exportOutputsLocks();
                               break;
             case EXP_SYSTEM:  exportSystem(debugLevel);
                               break;
@@ -662,6 +1047,8 @@ class ImportExport
                               break;
             case EXP_LOCKS:   exportLocks(false);
                               break;
+            case EXP_BACKUP:  exportBackup();
+                              break;
             default:          systemFail(M_EXPORT, aExport);
         }
     
@@ -36,7 +36,13 @@
 #define INPUT_TYPE_OFF            3     // An off Input.
 #define INPUT_TYPE_MAX            4     // Limit of Input types.
 
+#define INPUT_DEBOUNCE_BITS       3     // Bits in a debounce count, so a maximum of 7 scans.
+
+#define INPUT_CACHE_EMPTY      0xff     // Input number of an empty cache entry.
+
 #define INPUT_STATE_LEN           2     // Length on an Input MCP state message.
+#define INPUT_FLAGS_LEN           2     // Length on an Input MCP interrupt flags message.
+#define INPUT_CAPTURE_LEN         6     // Length on an Input MCP interrupt flags, capture and state message.
 
 
 // Mask for MCP device none or all bits.
@@ -54,7 +60,7 @@
 #define MCP_DEFVALB   0x07
 #define MCP_INTCONA   0x08    // Interup control, High = use DEFVAL, low = use previous value.
 #define MCP_INTCONB   0x09
-#define MCP_IOCON     0x0A    // Control register. Not used. See datasheet.
+#define MCP_IOCON     0x0A    // Control register. See datasheet.
 #define MCP_IOCON_DUP 0x0B
 #define MCP_GPPUA     0x0C    // Pull-ups. High = pull-up resistor enabled.
 #define MCP_GPPUB     0x0D
@@ -67,9 +73,22 @@
 #define MCP_OLATA     0x14    // Output latches (connected to GPIO pins).
 #define MCP_OLATB     0x15
 
-// Commands required to initialise MCPs.
-#define INPUT_COMMANDS_LEN 4
-uint8_t INPUT_COMMANDS[] = { MCP_IODIRA, MCP_IODIRB, MCP_GPPUA, MCP_GPPUB };
+// MCP control register bits.
+#define MCP_IOCON_MIRROR  0x40    // INTA and INTB pins are mirrored, either port's interrupts drive both.
+#define MCP_IOCON_ODR     0x04    // INT pins are open-drain so all the nodes can be wired-OR to one pin.
+
+// Commands (register, value) required to initialise MCPs.
+// All pins are inputs with pull-ups, interrupting on any change from their previous value.
+#define INPUT_COMMANDS_LEN 9
+uint8_t INPUT_COMMANDS[INPUT_COMMANDS_LEN][2] = { { MCP_IODIRA,   MCP_ALL_HIGH },
+                                                  { MCP_IODIRB,   MCP_ALL_HIGH },
+                                                  { MCP_GPPUA,    MCP_ALL_HIGH },
+                                                  { MCP_GPPUB,    MCP_ALL_HIGH },
+                                                  { MCP_INTCONA,  MCP_ALL_LOW  },
+                                                  { MCP_INTCONB,  MCP_ALL_LOW  },
+                                                  { MCP_GPINTENA, MCP_ALL_HIGH },
+                                                  { MCP_GPINTENB, MCP_ALL_HIGH },
+                                                  { MCP_IOCON,    MCP_IOCON_MIRROR | MCP_IOCON_ODR } };
 
 
 /** Definition of an Input..
@@ -195,6 +214,119 @@ class InputDef
 };
 
 
+/** Debouncing of an Input node's pins.
+ *  Uses vertical counters, each count word holds one bit of every pin's count
+ *  so all 16 pins are counted at once.
+ */
+class InputDebounce
+{
+    private:
+
+    uint16_t count[INPUT_DEBOUNCE_BITS];    // Consecutive scans each pin has differed from its state.
+    uint16_t limit[INPUT_DEBOUNCE_BITS];    // Scans each pin must differ from its state before it changes.
+#if INPUT_CAPTURE
+    uint16_t captured;                      // Pins holding a captured change until it's been debounced.
+    uint16_t rescan;                        // Pins whose captured change has just been made, scan them again.
+#endif
+
+
+    public:
+
+    /** Clear the counts and set all the pins' limits to one scan.
+     */
+    void reset()
+    {
+        for (uint8_t bit = 0; bit < INPUT_DEBOUNCE_BITS; bit++)
+        {
+            count[bit] = 0;
+            limit[bit] = bit ? 0 : 0xffff;
+        }
+#if INPUT_CAPTURE
+        captured = 0;
+        rescan   = 0;
+#endif
+    }
+
+
+    /** Set the number of scans a pin must differ from its state before it changes.
+     */
+    void setLimit(uint8_t aPin, uint8_t aScans)
+    {
+        uint16_t mask = 1 << aPin;
+
+        for (uint8_t bit = 0; bit < INPUT_DEBOUNCE_BITS; bit++)
+        {
+            if (aScans & (1 << bit))
+            {
+                limit[bit] |= mask;
+            }
+            else
+            {
+                limit[bit] &= ~mask;
+            }
+        }
+    }
+
+
+#if INPUT_CAPTURE
+    /** Hold pins in their changed state until they've been debounced.
+     *  For pins the interrupt capture saw change, so they're not missed if they've changed back by the scan.
+     */
+    void capture(uint16_t aPins)
+    {
+        captured |= aPins;
+    }
+#endif
+
+
+    /** Are any pins part way through being debounced?
+     */
+    boolean isDebouncing()
+    {
+#if INPUT_CAPTURE
+        return (count[0] | count[1] | count[2] | captured | rescan) != 0;
+#else
+        return (count[0] | count[1] | count[2]) != 0;
+#endif
+    }
+
+
+    /** Debounce a scan of the pins against their current state.
+     *  Return the new state of the pins.
+     */
+    uint16_t debounce(uint16_t aPins, uint16_t aState)
+    {
+#if INPUT_CAPTURE
+        aPins = (aPins & ~captured) | (~aState & captured);
+#endif
+        uint16_t delta = aPins ^ aState;        // Pins that differ from their state.
+
+        // Increment the counts of the pins that differ, clear the others.
+        count[2] = (count[2] ^ (count[1] & count[0])) & delta;
+        count[1] = (count[1] ^  count[0]            ) & delta;
+        count[0] = (           ~count[0]            ) & delta;
+
+        // Pins whose count has reached their limit change.
+        uint16_t change = delta & ~(  (count[0] ^ limit[0])
+                                    | (count[1] ^ limit[1])
+                                    | (count[2] ^ limit[2]));
+
+        for (uint8_t bit = 0; bit < INPUT_DEBOUNCE_BITS; bit++)
+        {
+            count[bit] &= ~change;
+        }
+
+#if INPUT_CAPTURE
+        // Captured changes that have been made are released, they may have changed back already.
+        rescan    = captured & change;
+        captured &= ~change;
+#endif
+
+        return aState ^ change;
+    }
+};
+
+
 /** Variables for working with an Input.
  */
 uint16_t   inputNodes  = 0;                 // Bit map of Input nodes present.
@@ -203,6 +335,28 @@ InputDef   inputDef;                        // Definition of the current Input.
 uint32_t   inputTypes  = 0L;                // The types of the Inputs. 2 bits per pin, 16 pins per node = 32 bits.
 uint8_t    inputType   = 0;                 // Type of the current Input (2 bits, INPUT_TYPE_MASK).
 
+InputDebounce inputDebounce[INPUT_NODE_MAX];    // Debouncing of each Input node's pins.
+
+
+/** Cache of Inputs' definitions and types.
+ *  Entries are kept in order, most recently used first.
+ */
+struct
+{
+    uint8_t  number;                        // The Input's number, or INPUT_CACHE_EMPTY.
+    InputDef def;                           // The Input's definition.
+} inputCache[INPUT_CACHE_SIZE];
+
+uint32_t   inputCacheTypes[INPUT_NODE_MAX]; // All the Inputs' types, a copy of the TYPES EEPROM.
+uint16_t   inputCacheHits   = 0;            // Number of Inputs loaded from the cache.
+uint16_t   inputCacheMisses = 0;            // Number of Inputs loaded from EEPROM.
+
+
+/** Initialise the Input cache.
+ *  Empty it, and load all the Input types from EEPROM.
+ */
+void initInputCache();
+
 
 /** Load an Input's data from EEPROM.
  */
@@ -220,6 +374,28 @@ void loadInput(uint8_t aNode, uint8_t aInput);
 void saveInput();
 
 
+/** Reset the debouncing of an Input node's pins.
+ *  Each pin's limit is set from its Input type.
+ */
+void resetInputDebounce(uint8_t aNode);
+
+
+/** Rebuild the index of the Input nodes that drive each Output node.
+ */
+void indexInputs();
+
+
+/** Update the index for all the Outputs that an Input node's Inputs drive.
+ */
+void indexInputNode(uint8_t aNode);
+
+
+/** Gets the Input nodes that have Inputs driving an Output node.
+ *  Return a bit map of the Input nodes.
+ */
+uint8_t getIndexedInputNodes(uint8_t aOutputNode);
+
+
 /** Record the presence of an InputNode in the map.
  */
 void setInputNodePresent(uint8_t aNode, boolean aState);
@@ -13,6 +13,64 @@
  #include "All.h"
 
 
+/** Initialise the Input cache.
+ *  Empty it, and load all the Input types from EEPROM.
+ */
+void initInputCache()
+{
+    for (uint8_t index = 0; index < INPUT_CACHE_SIZE; index++)
+    {
+        inputCache[index].number = INPUT_CACHE_EMPTY;
+    }
+
+    for (uint8_t node = 0; node < INPUT_NODE_MAX; node++)
+    {
+        EEPROM.get(TYPES_BASE + (node * TYPES_SIZE), inputCacheTypes[node]);
+    }
+}
+
+
+/** Load the current Input's definition from the cache.
+ *  Return true if it was there.
+ */
+boolean loadCachedInput()
+{
+    for (uint8_t index = 0; index < INPUT_CACHE_SIZE; index++)
+    {
+        if (inputCache[index].number == inputNumber)
+        {
+            inputDef = inputCache[index].def;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+
+/** Put the current Input's definition at the front of the cache.
+ *  Replaces the Input's existing entry, otherwise the least recently used one.
+ */
+void cacheInput()
+{
+    uint8_t index = 0;
+
+    while (   (index < INPUT_CACHE_SIZE - 1)
+           && (inputCache[index].number != inputNumber))
+    {
+        index += 1;
+    }
+
+    for (; index > 0; index--)
+    {
+        inputCache[index] = inputCache[index - 1];
+    }
+
+    inputCache[0].number = inputNumber;
+    inputCache[0].def    = inputDef;
+}
+
+
 /** Load an Input's data from EEPROM.
  */
 void loadInput(uint8_t aInput)
@@ -29,9 +87,20 @@ void loadInput(uint8_t aNode, uint8_t aPin)
 
     inputNumber = ((aNode & INPUT_NODE_MASK) << INPUT_NODE_SHIFT) | (aPin & INPUT_PIN_MASK);
 
-    EEPROM.get(INPUT_BASE + (inputNumber * INPUT_SIZE), inputDef);
-    EEPROM.get(TYPES_BASE + (aNode       * TYPES_SIZE), inputTypes);
-    inputType = (inputTypes >> (aPin << INPUT_TYPE_SHIFT)) & INPUT_TYPE_MASK;
+    // Use the cached definition if there is one.
+    if (loadCachedInput())
+    {
+        inputCacheHits += 1;
+    }
+    else
+    {
+        EEPROM.get(INPUT_BASE + (inputNumber * INPUT_SIZE), inputDef);
+        inputCacheMisses += 1;
+    }
+    cacheInput();
+
+    inputTypes = inputCacheTypes[aNode & INPUT_NODE_MASK];
+    inputType  = (inputTypes >> (aPin << INPUT_TYPE_SHIFT)) & INPUT_TYPE_MASK;
 
     if (isDebug(DEBUG_DETAIL))
     {
@@ -57,6 +126,10 @@ void loadInput(uint8_t aNode, uint8_t aPin)
                 Serial.print(CHAR_SPACE);
             }
         }
+        Serial.print(PGMT(M_DEBUG_HITS));
+        Serial.print(inputCacheHits);
+        Serial.print(PGMT(M_DEBUG_MISSES));
+        Serial.print(inputCacheMisses);
         Serial.println();
 
 //        Serial.print(millis());
@@ -87,9 +160,15 @@ void saveInput()
         uint8_t  pin  = (inputNumber                    ) & INPUT_PIN_MASK;
         uint32_t mask = ((long)INPUT_TYPE_MASK) << (pin << INPUT_TYPE_SHIFT);
         
-        inputTypes = (inputTypes & ~mask) | ((((long)inputType) << (pin << INPUT_TYPE_SHIFT)) & mask);
+        // Write through the cache.
+        inputTypes = (inputCacheTypes[node] & ~mask) | ((((long)inputType) << (pin << INPUT_TYPE_SHIFT)) & mask);
+        inputCacheTypes[node] = inputTypes;
+        cacheInput();
+
         EEPROM.put(INPUT_BASE + (inputNumber * INPUT_SIZE), inputDef);
         EEPROM.put(TYPES_BASE + (node        * TYPES_SIZE), inputTypes);
+        indexInputNode(node);
+        resetInputDebounce(node);
 
         if (isDebug(DEBUG_DETAIL))
         {
@@ -137,12 +216,86 @@ void saveInput()
 }
 
 
+/** Reset the debouncing of an Input node's pins.
+ *  Each pin's limit is set from its Input type.
+ */
+void resetInputDebounce(uint8_t aNode)
+{
+    uint32_t types = inputCacheTypes[aNode];
+
+    inputDebounce[aNode].reset();
+    for (uint8_t pin = 0; pin < INPUT_PIN_MAX; pin++)
+    {
+        inputDebounce[aNode].setLimit(pin, INPUT_DEBOUNCE[(types >> (pin << INPUT_TYPE_SHIFT)) & INPUT_TYPE_MASK]);
+    }
+}
+
+
+/** Rebuild the index of the Input nodes that drive each Output node.
+ */
+void indexInputs()
+{
+    for (uint8_t node = 0; node < INPUT_NODE_MAX; node++)
+    {
+        indexInputNode(node);
+    }
+}
+
+
+/** Update the index for all the Outputs that an Input node's Inputs drive.
+ *  Reads the definitions directly from EEPROM so the current Input isn't disturbed.
+ */
+void indexInputNode(uint8_t aNode)
+{
+    InputDef def;
+    uint32_t outputNodes = 0L;      // Bit map of the Output nodes driven by this Input node.
+    uint8_t  number      = (aNode & INPUT_NODE_MASK) << INPUT_NODE_SHIFT;
+
+    for (uint8_t pin = 0; pin < INPUT_PIN_MAX; pin++)
+    {
+        EEPROM.get(INPUT_BASE + ((number + pin) * INPUT_SIZE), def);
+        for (uint8_t index = 0; index < INPUT_OUTPUT_MAX; index++)
+        {
+            if (!def.isDelay(index))
+            {
+                outputNodes |= 1L << def.getOutputNode(index);
+            }
+        }
+    }
+
+    // Update the Output nodes' entries, EEPROM only written if they change.
+    for (uint8_t node = 0; node < OUTPUT_NODE_MAX; node++)
+    {
+        uint8_t entry = EEPROM.read(INDEX_BASE + node * INDEX_SIZE);
+        if (outputNodes & (1L << node))
+        {
+            entry |= (1 << aNode);
+        }
+        else
+        {
+            entry &= ~(1 << aNode);
+        }
+        EEPROM.update(INDEX_BASE + node * INDEX_SIZE, entry);
+    }
+}
+
+
+/** Gets the Input nodes that have Inputs driving an Output node.
+ *  Return a bit map of the Input nodes.
+ */
+uint8_t getIndexedInputNodes(uint8_t aOutputNode)
+{
+    return EEPROM.read(INDEX_BASE + (aOutputNode & OUTPUT_NODE_MASK) * INDEX_SIZE);
+}
+
+
 /** Record the presence of an InputNode in the map.
  */
 void setInputNodePresent(uint8_t aNode, boolean aState)
 {
     if (aState)
     {
+        resetHealth(HEALTH_INPUT(aNode));
         inputNodes |= (1 << aNode);
     }
     else
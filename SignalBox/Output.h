@@ -36,8 +36,12 @@
 // Masks for locks.
 #define OUTPUT_LOCK_MAX             4   // Four locks of each type (Hi/Lo).
 
+// Batches of state changes.
+#define OUTPUT_BATCH_MAX            8   // Most state changes waiting to be sent as a batch.
+
 // Wire response message lengths.
 #define OUTPUT_STATE_LEN            1   // One byte used to return a node's Outputs' states.
+#define OUTPUT_CAPS_LEN             1   // One byte used to return a node's capabilities.
 #define OUTPUT_RENUMBER_LEN         1   // One byte used to return a node's new module ID.
 #define OUTPUT_MOVE_LOCK_LEN        3   // Two bytes used to move a nodes locks.
 
@@ -258,6 +262,14 @@ class OutputDef
     }
 
 
+    /** Get all the enabled locks.
+     */
+    uint8_t getLocks()
+    {
+        return locks;
+    }
+
+
     /** Write an Output down the i2c bus.
      *  Must be the same order as read().
      */
@@ -279,24 +291,24 @@ class OutputDef
     }
 
 
-    /** Read an Output from the i2c bus.
+    /** Read an Output from the i2c bus (or a received frame).
      *  Must be the same order as write().
      */
-    void read()
+    void read(Stream& aStream = Wire)
     {
-        type  = Wire.read();
-        lo    = Wire.read();
-        hi    = Wire.read();
-        pace  = Wire.read();
-        reset = Wire.read();
+        type  = aStream.read();
+        lo    = aStream.read();
+        hi    = aStream.read();
+        pace  = aStream.read();
+        reset = aStream.read();
 
-        locks = Wire.read();
+        locks = aStream.read();
         for (uint8_t index = 0; index < OUTPUT_LOCK_MAX; index++)
         {
-            lockLo[index] = Wire.read();
-            lockHi[index] = Wire.read();
+            lockLo[index] = aStream.read();
+            lockHi[index] = aStream.read();
         }
-        lockState = Wire.read();
+        lockState = aStream.read();
     }
 
 
@@ -476,15 +488,124 @@ class OutputDef
 #ifdef OUTPUT_BASE      // Methods for loading/saving outputs to/from EEPROM in the OutputModule.
 
 
+#define JOURNAL_CHECK       0xa5    // Mixed into a journal entry's check, so erased EEPROM isn't valid.
+
+
 // The Outputs' data in RAM.
 OutputDef outputDefs[OUTPUT_PIN_MAX];
 
+// The journal of the Outputs' states.
+uint8_t journalIndex    = JOURNAL_MAX - 1;  // The newest entry.
+uint8_t journalSequence = 0;                // The newest entry's sequence number.
+uint8_t journalStates   = 0;                // The states saved in the newest entry, a bit for each Output.
+
+
+/** Read a journal entry.
+ *  Return true if it's valid.
+ */
+boolean readStateJournal(uint8_t aIndex, uint8_t &aSequence, uint8_t &aStates)
+{
+    int address = JOURNAL_BASE + aIndex * JOURNAL_SIZE;
+
+    aSequence = EEPROM.read(address);
+    aStates   = EEPROM.read(address + 1);
+
+    return EEPROM.read(address + 2) == (aSequence ^ aStates ^ JOURNAL_CHECK);
+}
+
+
+/** Find the newest journal entry, the last valid one before the sequence breaks.
+ *  If there isn't one, use the states saved in the Outputs' definitions.
+ */
+void loadStateJournal()
+{
+    uint8_t sequence     = 0;
+    uint8_t states       = 0;
+    uint8_t nextSequence = 0;
+    uint8_t nextStates   = 0;
+    
+    journalIndex    = JOURNAL_MAX - 1;
+    journalSequence = 0;
+    journalStates   = 0;
+    
+    for (uint8_t pin = 0; pin < OUTPUT_PIN_MAX; pin++)
+    {
+        OutputDef def;
+        EEPROM.get(OUTPUT_BASE + pin * sizeof(OutputDef), def);
+        if (def.getState())
+        {
+            journalStates |= 1 << pin;
+        }
+    }
+
+    for (uint8_t index = 0; index < JOURNAL_MAX; index++)
+    {
+        if (   (readStateJournal(index, sequence, states))
+            && (   (!readStateJournal((index + 1) % JOURNAL_MAX, nextSequence, nextStates))
+                || (nextSequence != (uint8_t)(sequence + 1))))
+        {
+            journalIndex    = index;
+            journalSequence = sequence;
+            journalStates   = states;
+            break;
+        }
+    }
+}
+
+
+/** Save the Outputs' states in the next journal entry.
+ *  Only if they've changed.
+ */
+void saveStateJournal()
+{
+    uint8_t states  = 0;
+    int     address = 0;
+
+    for (uint8_t pin = 0; pin < OUTPUT_PIN_MAX; pin++)
+    {
+        if (outputDefs[pin].getState())
+        {
+            states |= 1 << pin;
+        }
+    }
+
+    if (states != journalStates)
+    {
+        journalIndex     = (journalIndex + 1) % JOURNAL_MAX;
+        journalSequence += 1;
+        journalStates    = states;
+
+        // Check written last, so a partial entry isn't valid.
+        address = JOURNAL_BASE + journalIndex * JOURNAL_SIZE;
+        EEPROM.update(address,     journalSequence);
+        EEPROM.update(address + 1, journalStates);
+        EEPROM.update(address + 2, journalSequence ^ journalStates ^ JOURNAL_CHECK);
+    }
+}
+
+
+/** Erase the journal.
+ */
+void clearStateJournal()
+{
+    for (int address = JOURNAL_BASE; address < JOURNAL_END; address++)
+    {
+        EEPROM.update(address, 0xff);
+    }
+
+    journalIndex    = JOURNAL_MAX - 1;
+    journalSequence = 0;
+    journalStates   = 0;
+}
+
 
 /** Load an Output's definition from EEPROM.
+ *  Its state is the one saved in the journal.
  */
 void loadOutput(uint8_t aPin)
 {
     EEPROM.get(OUTPUT_BASE + aPin * sizeof(OutputDef), outputDefs[aPin]);
+    outputDefs[aPin].setState(journalStates & (1 << aPin));
     if (isDebug(DEBUG_DETAIL))
     { 
         outputDefs[aPin].printDef(M_DEBUG_LOAD, aPin);
@@ -542,6 +663,115 @@ uint8_t    outputPin    = 0;    // Current Output pin.
 OutputDef  outputDef;           // Definition of current Output.
 
 uint8_t    outputStates[OUTPUT_NODE_MAX];   // State of all the attached output module's Outputs.
+uint8_t    outputCaps[OUTPUT_NODE_MAX];     // Optional commands each output module supports, see COMMS_CAP_...
+uint8_t    outputQueued[OUTPUT_NODE_MAX];   // Commands sent to each output module since it last had none queued.
+long       outputStatesDue = 0;             // Bit map of Output nodes that were too busy to report their states.
+
+
+/** State changes waiting to be sent to the Output modules, in the order they were made.
+ */
+struct
+{
+    uint8_t node;                           // The Output's node.
+    uint8_t pinState;                       // The Output's pin, and the state (OUTPUT_STATE_MASK) to set it to.
+    uint8_t delay;                          // Delay before the Output's actioned.
+} outputBatch[OUTPUT_BATCH_MAX];
+
+uint8_t    outputBatchCount = 0;            // Number of state changes waiting in the batch.
+
+
+/** Delayed state changes waiting until it's time to send them to the Output modules.
+ */
+struct
+{
+    long    at;                             // When (millis()) to send the change.
+    uint8_t node;                           // The Output's node.
+    uint8_t pinState;                       // The Output's pin, and the state (OUTPUT_STATE_MASK) to set it to.
+} outputTimeline[OUTPUT_TIMELINE_MAX];
+
+uint8_t    outputTimelineCount = 0;         // Number of state changes waiting in the timeline.
+
+
+/** A compiled lock term.
+ *  The Output's locked if any of the term node's Outputs in hi are Hi, or any in lo are Lo.
+ */
+struct OutputLockTerm
+{
+    uint8_t node;                           // The node of the locking Outputs.
+    uint8_t hi;                             // The node's Outputs that lock when Hi.
+    uint8_t lo;                             // The node's Outputs that lock when Lo.
+};
+
+
+/** Cache of recently used Outputs' locks, most recently used first.
+ *  Each direction's locks are compiled into a term per locking node.
+ *  An entry is only valid if its generation matches its node's generation, and its pin is known.
+ */
+struct OutputLocks
+{
+    uint8_t        output;                      // The Output's number (node and pin).
+    uint8_t        generation;                  // The node's generation when the entry was cached.
+    uint8_t        terms[2];                    // Number of terms that lock this output Lo, and Hi.
+    OutputLockTerm term[2][OUTPUT_LOCK_MAX];    // The terms that lock this output Lo, and Hi.
+} outputLockCache[OUTPUT_LOCK_CACHE_SIZE];
+
+uint8_t    outputLockGeneration[OUTPUT_NODE_MAX];   // Incremented whenever a node's Outputs may have changed.
+uint8_t    outputLockKnown[OUTPUT_NODE_MAX];        // Pins whose locks are known since the node's last change.
+uint8_t    outputLockPins[OUTPUT_NODE_MAX];         // Known pins that have locks.
+
+
+/** Forget all the cached locks of the given node's Outputs.
+ *  Called whenever the node's Outputs may have changed.
+ */
+void invalidateOutputLocks(uint8_t aNode);
+
+
+/** Read and cache the locks of all the given node's Outputs.
+ */
+void readOutputLocks(uint8_t aNode);
+
+
+/** Put the current Output's locks at the front of the cache.
+ */
+void cacheOutputLocks();
+
+
+/** Load the locks of the given Output, from the cache if possible.
+ *  Return true if the Output has locks, they'll be in the first cache entry.
+ */
+boolean loadOutputLocks(uint8_t aNode, uint8_t aPin);
+
+
+/** Find which of the first cache entry's locks prevent it being set to the given state.
+ *  Return the term's locking Outputs, or zero if not locked.
+ */
+uint8_t getOutputLocks(boolean aState, uint8_t &aNode);
+
+
+/** Begin a transmission to an Output node.
+ *  If the node may have queued as many commands as it can take, first wait until it acknowledges.
+ */
+void beginOutputTransmission(uint8_t aNode);
+
+
+/** End a transmission (that has no response) to an Output node.
+ *  Record an error if the node's present, but didn't accept it.
+ */
+void endOutputTransmission(uint8_t aNode);
+
+
+/** Read a response from an Output node.
+ *  Nodes with COMMS_CAP_STATUS are asked again (a few times, see COMMS_BUSY_POLLS) while they're busy.
+ *  Return COMMS_REPLY_READY if the response is available to read, COMMS_REPLY_BUSY if the node's still busy, else -1.
+ */
+int requestOutputResponse(uint8_t aNode, uint8_t aLen);
+
+
+/** Read a response from an Output node that can't be left until later, waiting while it's busy.
+ *  Only for as long as it takes the node to save an Output (see COMMS_SAVE_POLLS).
+ *  Return as requestOutputResponse().
+ */
+int waitOutputResponse(uint8_t aNode, uint8_t aLen);
 
 
 /** Read an Output's data from an OutputModule.
@@ -569,6 +799,48 @@ void writeSaveOutput();
 void writeOutputState(uint8_t aNode, uint8_t aPin, boolean aState, uint8_t aDelay);
 
 
+/** Write a change of state to the Output module, and recover all the node's states.
+ *  A single transaction if the module can report its states, else the states are read separately.
+ */
+void writeReadOutputState(uint8_t aNode, uint8_t aPin, boolean aState, uint8_t aDelay);
+
+
+/** End a transmission to the given node, and read its Outputs' states in response.
+ *  Uses a repeated start so it's a single transaction.
+ */
+void endReadOutputStates(uint8_t aNode);
+
+
+/** Add a change of state to the batch waiting to be sent to the Output modules.
+ */
+void batchOutputState(uint8_t aNode, uint8_t aPin, boolean aState, uint8_t aDelay);
+
+
+/** Send the batch of state changes to the Output modules.
+ *  One transaction for each node that supports batches, else one for each change.
+ */
+void sendOutputBatch();
+
+
+/** Schedule a change of state, aDelay seconds from now.
+ *  Replaces any change still waiting for the same Output.
+ *  Changes that are due now go straight into the batch.
+ */
+void scheduleOutputState(uint8_t aNode, uint8_t aPin, boolean aState, uint8_t aDelay);
+
+
+/** Send all the scheduled changes of state that are now due.
+ */
+void sendOutputTimeline();
+
+
+/** Action all the Outputs on all the nodes, see COMMS_ALL_...
+ *  One broadcast for all the nodes that support it, then recover all the nodes' states.
+ *  Abandons any scheduled changes.
+ */
+void writeAllOutputs(uint8_t aOption);
+
+
 /** Reset current Output. 
  *  And then reload its definition.
  */
@@ -577,10 +849,23 @@ void resetOutput();
 
 /** Read the states of the given node's Outputs.
  *  Save in OutputStates.
+ *  If the node's too busy, they're read later (see readDueOutputStates()).
  */
 void readOutputStates(uint8_t aNode);
 
 
+/** Read the states of the first Output node that was too busy to report them.
+ *  Just one node each time, so Input scanning isn't held up.
+ */
+void readDueOutputStates();
+
+
+/** Read the optional commands the given node supports.
+ *  Save in outputCaps. Return true if the node responded.
+ */
+boolean readOutputCaps(uint8_t aNode);
+
+
 /** Gets the states of all the given node's Outputs.
  */
 uint8_t getOutputStates(uint8_t aNode);
@@ -601,6 +886,12 @@ boolean getOutputState(uint8_t aNode, uint8_t aPin);
 void setOutputState(uint8_t aNode, uint8_t aPin, boolean aState);
 
 
+/** Record an error communicating with an Output node.
+ *  Only take the node offline once it's had too many errors.
+ */
+void recordOutputError(uint8_t aNode);
+
+
 /** Record the presence of an OutputNode in the map.
  */
 void setOutputNodePresent(uint8_t aNode, boolean aState);
@@ -14,10 +14,127 @@
  #include "All.h"
 
 
+/** Begin a transmission to an Output node.
+ *  If the node may have queued as many commands as it can take, first wait until it acknowledges.
+ */
+void beginOutputTransmission(uint8_t aNode)
+{
+    if (   (outputCaps[aNode] & COMMS_CAP_STATUS)
+        && (outputQueued[aNode] >= COMMS_QUEUE_FREE)
+        && (isOutputNodePresent(aNode)))
+    {
+        // The node stops acknowledging while its queue's nearly full (for as long as it takes to save an Output).
+        boolean ok = false;
+        
+        for (uint8_t poll = 0; (!ok) && (poll < COMMS_HOLD_POLLS); poll++)
+        {
+            if (poll > 0)
+            {
+                delay(COMMS_HOLD_DELAY);
+            }
+            
+            Wire.beginTransmission(I2C_OUTPUT_BASE_ID + aNode);
+            ok = Wire.endTransmission() == 0;
+        }
+
+        // Acknowledging, so there's room for at least one more.
+        outputQueued[aNode] = COMMS_QUEUE_FREE - 1;
+    }
+
+    outputQueued[aNode] += 1;
+    Wire.beginTransmission(I2C_OUTPUT_BASE_ID + aNode);
+}
+
+
+/** End a transmission (that has no response) to an Output node.
+ *  Record an error if the node's present, but didn't accept it.
+ */
+void endOutputTransmission(uint8_t aNode)
+{
+    if (   (Wire.endTransmission() != 0)
+        && (isOutputNodePresent(aNode)))
+    {
+        recordOutputError(aNode);
+    }
+}
+
+
+/** Read a response from an Output node.
+ *  Nodes with COMMS_CAP_STATUS are asked again (a few times, see COMMS_BUSY_POLLS) while they're busy.
+ *  Return COMMS_REPLY_READY if the response is available to read, COMMS_REPLY_BUSY if the node's still busy, else -1.
+ */
+int requestOutputResponse(uint8_t aNode, uint8_t aLen)
+{
+    int length = aLen;
+    int status = COMMS_REPLY_BUSY;
+
+    if ((outputCaps[aNode] & COMMS_CAP_STATUS) == 0)
+    {
+        // Older module, the response has no status byte.
+        return Wire.requestFrom(I2C_OUTPUT_BASE_ID + aNode, length) == length ? COMMS_REPLY_READY : -1;
+    }
+    
+    for (uint8_t poll = 0; (status == COMMS_REPLY_BUSY) && (poll < COMMS_BUSY_POLLS); poll++)
+    {
+        if (poll > 0)
+        {
+            delay(COMMS_BUSY_DELAY);
+        }
+
+        // Discard anything left from a busy response.
+        while (Wire.available())
+        {
+            Wire.read();
+        }
+
+        if (Wire.requestFrom(I2C_OUTPUT_BASE_ID + aNode, length + 1) == length + 1)
+        {
+            status = Wire.read();
+        }
+        else
+        {
+            status = -1;
+        }
+    }
+
+    if (status == COMMS_REPLY_READY)
+    {
+        outputQueued[aNode] = 0;        // It's processed everything sent to it.
+    }
+    else if (status != COMMS_REPLY_BUSY)
+    {
+        status = -1;
+    }
+
+    return status;
+}
+
+
+/** Read a response from an Output node that can't be left until later, waiting while it's busy.
+ *  Only for as long as it takes the node to save an Output (see COMMS_SAVE_POLLS).
+ *  Return as requestOutputResponse().
+ */
+int waitOutputResponse(uint8_t aNode, uint8_t aLen)
+{
+    int status = requestOutputResponse(aNode, aLen);
+
+    for (uint8_t poll = 0; (status == COMMS_REPLY_BUSY) && (poll < COMMS_SAVE_POLLS); poll++)
+    {
+        delay(COMMS_BUSY_DELAY);
+        status = requestOutputResponse(aNode, aLen);
+    }
+
+    return status;
+}
+
+
 /** Read an Output's data from an OutputModule.
  */
 void readOutput(uint8_t aNode, uint8_t aPin)
 {
+    boolean ok     = false;
+    int     status = -1;
+    
     if (isOutputNodePresent(aNode))
     {
         outputNode = aNode;
@@ -33,14 +150,28 @@ void readOutput(uint8_t aNode, uint8_t aPin)
             Serial.println();
         }
     
-        Wire.beginTransmission(I2C_OUTPUT_BASE_ID + outputNode);
-        Wire.write(COMMS_CMD_READ | outputPin);
-        if (   (Wire.endTransmission() == 0)
-            && (Wire.requestFrom(I2C_OUTPUT_BASE_ID + outputNode, sizeof(outputDef)) == sizeof(outputDef))
-            && (Wire.available() == sizeof(outputDef)))
+        // Don't retry a node that's still busy, it's not failing.
+        for (uint8_t attempt = 0; (!ok) && (status != COMMS_REPLY_BUSY) && (attempt <= HEALTH_RETRIES); attempt++)
+        {
+            if (attempt > 0)
+            {
+                retryHealth(attempt - 1);
+            }
+            
+            beginOutputTransmission(outputNode);
+            Wire.write(COMMS_CMD_READ | outputPin);
+            status = -1;
+            ok =    (Wire.endTransmission() == 0)
+                 && ((status = waitOutputResponse(outputNode, sizeof(outputDef))) == COMMS_REPLY_READY)
+                 && (Wire.available() == sizeof(outputDef));
+        }
+        
+        if (ok)
         {
             // Read the outputDef from the OutputModule.
+            recordHealthOk(HEALTH_OUTPUT(aNode));
             outputDef.read();
+            cacheOutputLocks();
             
             if (isDebug(DEBUG_DETAIL))
             {
@@ -50,8 +181,10 @@ void readOutput(uint8_t aNode, uint8_t aPin)
         else
         {
             outputDef.set(OUTPUT_TYPE_NONE, false, OUTPUT_DEFAULT_LO, OUTPUT_DEFAULT_HI, OUTPUT_DEFAULT_PACE, 0);
-            systemFail(M_OUTPUT, aNode);
-            setOutputNodePresent(aNode, false);
+            if (status != COMMS_REPLY_BUSY)
+            {
+                recordOutputError(aNode);
+            }
         }
 
         // Ignore any data that's left
@@ -90,10 +223,12 @@ void writeOutput()
         outputDef.printDef(M_DEBUG_WRITE, outputPin);
     }
 
-    Wire.beginTransmission(I2C_OUTPUT_BASE_ID + outputNode);
+    beginOutputTransmission(outputNode);
     Wire.write(COMMS_CMD_WRITE | outputPin);
     outputDef.write();
-    Wire.endTransmission();
+    endOutputTransmission(outputNode);
+
+    invalidateOutputLocks(outputNode);
 }
 
 
@@ -112,9 +247,11 @@ void writeSaveOutput()
         outputDef.printDef(M_DEBUG_SAVE, outputPin);
     }
 
-    Wire.beginTransmission(I2C_OUTPUT_BASE_ID + outputNode);
+    beginOutputTransmission(outputNode);
     Wire.write(COMMS_CMD_SAVE | outputPin);
-    Wire.endTransmission();
+    endOutputTransmission(outputNode);
+
+    invalidateOutputLocks(outputNode);
 }
 
 
@@ -136,10 +273,311 @@ void writeOutputState(uint8_t aNode, uint8_t aPin, boolean aState, uint8_t aDela
         Serial.println();
     }
 
-    Wire.beginTransmission(I2C_OUTPUT_BASE_ID + aNode);
+    beginOutputTransmission(aNode);
     Wire.write((aState ? COMMS_CMD_SET_HI : COMMS_CMD_SET_LO) | aPin);
     Wire.write(aDelay);
+    endOutputTransmission(aNode);
+}
+
+
+/** Write a change of state to the Output module, and recover all the node's states.
+ *  A single transaction if the module can report its states, else the states are read separately.
+ */
+void writeReadOutputState(uint8_t aNode, uint8_t aPin, boolean aState, uint8_t aDelay)
+{
+    if ((outputCaps[aNode] & COMMS_CAP_STATES) == 0)
+    {
+        // Older module, so send the change and then read the states.
+        writeOutputState(aNode, aPin, aState, aDelay);
+        readOutputStates(aNode);
+    }
+    else
+    {
+        if (isDebug(DEBUG_BRIEF))
+        {
+            Serial.print(millis());
+            Serial.print(CHAR_TAB);
+            Serial.print(PGMT(M_DEBUG_SEND));
+            Serial.print(aNode, HEX);
+            Serial.print(aPin, HEX);
+            Serial.print(PGMT(M_DEBUG_STATE));
+            Serial.print(PGMT(aState ? M_HI : M_LO));
+            Serial.print(PGMT(M_DEBUG_DELAY_TO));
+            Serial.print(aDelay, HEX);
+            Serial.println();
+        }
+
+        // Send the change, then read the resulting states.
+        beginOutputTransmission(aNode);
+        Wire.write((aState ? COMMS_CMD_SET_HI : COMMS_CMD_SET_LO) | COMMS_SET_REPORT | aPin);
+        Wire.write(aDelay);
+        endReadOutputStates(aNode);
+    }
+}
+
+
+/** End a transmission to the given node, and read its Outputs' states in response.
+ *  Uses a repeated start so it's a single transaction.
+ */
+void endReadOutputStates(uint8_t aNode)
+{
+    int states = -1;
+    int status = -1;
+    
+    if (   (Wire.endTransmission(false) == 0)
+        && ((status = requestOutputResponse(aNode, OUTPUT_STATE_LEN)) == COMMS_REPLY_READY)
+        && ((states = Wire.read()) >= 0))
+    {
+        setOutputStates(aNode, states);
+
+        if (isDebug(DEBUG_DETAIL))
+        {
+            Serial.print(millis());
+            Serial.print(CHAR_TAB);
+            Serial.print(PGMT(M_DEBUG_STATES));
+            Serial.print(aNode, HEX);
+            Serial.print(CHAR_SPACE);
+            Serial.print(states, HEX);
+            Serial.println();
+        }
+    }
+    else if (status == COMMS_REPLY_BUSY)
+    {
+        outputStatesDue |= ((long)1 << aNode);      // Still working, read them later.
+    }
+    else
+    {
+        recordOutputError(aNode);
+    }
+}
+
+
+/** Add a change of state to the batch waiting to be sent to the Output modules.
+ */
+void batchOutputState(uint8_t aNode, uint8_t aPin, boolean aState, uint8_t aDelay)
+{
+    if (outputBatchCount >= OUTPUT_BATCH_MAX)
+    {
+        sendOutputBatch();          // No room, so send what's waiting.
+    }
+
+    outputBatch[outputBatchCount].node     = aNode;
+    outputBatch[outputBatchCount].pinState = (aState ? OUTPUT_STATE_MASK : 0) | aPin;
+    outputBatch[outputBatchCount].delay    = aDelay;
+    outputBatchCount += 1;
+}
+
+
+/** Send the batch of state changes to the Output modules.
+ *  One transaction for each node that supports batches, else one for each change.
+ */
+void sendOutputBatch()
+{
+    for (uint8_t first = 0; first < outputBatchCount; first++)
+    {
+        uint8_t node  = outputBatch[first].node;
+        uint8_t count = 0;
+        uint8_t index = 0;
+
+        // Skip nodes that have already been sent.
+        while (   (index < first)
+               && (outputBatch[index].node != node))
+        {
+            index += 1;
+        }
+
+        if (index == first)
+        {
+            // Count the node's changes.
+            for (index = first; index < outputBatchCount; index++)
+            {
+                if (outputBatch[index].node == node)
+                {
+                    count += 1;
+                }
+            }
+
+            if (   (count > 1)
+                && (outputCaps[node] & COMMS_CAP_BATCH))
+            {
+                if (isDebug(DEBUG_BRIEF))
+                {
+                    Serial.print(millis());
+                    Serial.print(CHAR_TAB);
+                    Serial.print(PGMT(M_DEBUG_BATCH));
+                    Serial.print(PGMT(M_DEBUG_NODE));
+                    Serial.print(node, HEX);
+                    Serial.print(PGMT(M_DEBUG_OUTPUTS));
+                    Serial.print(count);
+                    Serial.println();
+                }
+
+                // Send all the node's changes in one frame.
+                beginOutputTransmission(node);
+                Wire.write(COMMS_CMD_BATCH | count);
+                for (index = first; index < outputBatchCount; index++)
+                {
+                    if (outputBatch[index].node == node)
+                    {
+                        Wire.write(outputBatch[index].pinState);
+                        Wire.write(outputBatch[index].delay);
+                    }
+                }
+                endReadOutputStates(node);
+            }
+            else
+            {
+                // Send the node's changes one at a time.
+                for (index = first; index < outputBatchCount; index++)
+                {
+                    if (outputBatch[index].node == node)
+                    {
+                        writeReadOutputState(node, 
+                                             outputBatch[index].pinState & OUTPUT_PIN_MASK, 
+                                             (outputBatch[index].pinState & OUTPUT_STATE_MASK) != 0,
+                                             outputBatch[index].delay);
+                    }
+                }
+            }
+        }
+    }
+
+    outputBatchCount = 0;
+}
+
+
+/** Schedule a change of state, aDelay seconds from now.
+ *  Replaces any change still waiting for the same Output.
+ *  Changes that are due now go straight into the batch.
+ *  The Output's state is the new state from now on (as the module would report it),
+ *  so locks and toggles see it, only the movement waits.
+ */
+void scheduleOutputState(uint8_t aNode, uint8_t aPin, boolean aState, uint8_t aDelay)
+{
+    uint8_t pinState = (aState ? OUTPUT_STATE_MASK : 0) | aPin;
+    uint8_t count    = 0;
+
+    // Remove any change waiting for the same Output.
+    for (uint8_t index = 0; index < outputTimelineCount; index++)
+    {
+        if (   (outputTimeline[index].node != aNode)
+            || ((outputTimeline[index].pinState & OUTPUT_PIN_MASK) != aPin))
+        {
+            outputTimeline[count++] = outputTimeline[index];
+        }
+    }
+    outputTimelineCount = count;
+
+    if (aDelay == 0)
+    {
+        batchOutputState(aNode, aPin, aState, 0);
+    }
+    else if (outputTimelineCount < OUTPUT_TIMELINE_MAX)
+    {
+        outputTimeline[outputTimelineCount].at       = millis() + DELAY_MULTIPLIER * aDelay;
+        outputTimeline[outputTimelineCount].node     = aNode;
+        outputTimeline[outputTimelineCount].pinState = pinState;
+        outputTimelineCount += 1;
+
+        setOutputState(aNode, aPin, aState);
+    }
+    else
+    {
+        batchOutputState(aNode, aPin, aState, aDelay);  // No room, so let the Output module time the delay.
+    }
+}
+
+
+/** Send all the scheduled changes of state that are now due.
+ */
+void sendOutputTimeline()
+{
+    if (outputTimelineCount > 0)
+    {
+        long    now   = millis();
+        uint8_t count = 0;
+
+        // Batch all the due changes, keep the others.
+        for (uint8_t index = 0; index < outputTimelineCount; index++)
+        {
+            if (now >= outputTimeline[index].at)
+            {
+                batchOutputState(outputTimeline[index].node,
+                                 outputTimeline[index].pinState & OUTPUT_PIN_MASK,
+                                 (outputTimeline[index].pinState & OUTPUT_STATE_MASK) != 0,
+                                 0);
+            }
+            else
+            {
+                outputTimeline[count++] = outputTimeline[index];
+            }
+        }
+        outputTimelineCount = count;
+
+        sendOutputBatch();
+    }
+}
+
+
+/** Action all the Outputs on all the nodes, see COMMS_ALL_...
+ *  One broadcast for all the nodes that support it, then recover all the nodes' states.
+ *  Abandons any scheduled changes.
+ */
+void writeAllOutputs(uint8_t aOption)
+{
+    outputTimelineCount = 0;
+
+    uint8_t command = COMMS_CMD_SET_LO;     // Equivalent command for each Output.
+
+    switch (aOption)
+    {
+        case COMMS_ALL_HI:    command = COMMS_CMD_SET_HI;
+                              break;
+        case COMMS_ALL_RESET: command = COMMS_CMD_RESET;
+                              break;
+    }
+    
+    if (isDebug(DEBUG_BRIEF))
+    {
+        Serial.print(millis());
+        Serial.print(CHAR_TAB);
+        Serial.print(PGMT(M_DEBUG_ALL));
+        Serial.print(CHAR_SPACE);
+        Serial.print(aOption, HEX);
+        Serial.println();
+    }
+
+    Wire.beginTransmission(I2C_BROADCAST_ID);
+    Wire.write(COMMS_CMD_ALL | aOption);
     Wire.endTransmission();
+
+    for (uint8_t node = 0; node < OUTPUT_NODE_MAX; node++)
+    {
+        if (isOutputNodePresent(node))
+        {
+            // Older modules don't receive broadcasts, so action each of their Outputs.
+            if ((outputCaps[node] & COMMS_CAP_BROADCAST) == 0)
+            {
+                for (uint8_t pin = 0; pin < OUTPUT_PIN_MAX; pin++)
+                {
+                    Wire.beginTransmission(I2C_OUTPUT_BASE_ID + node);
+                    Wire.write(command | pin);
+                    Wire.endTransmission();
+                }
+            }
+            else
+            {
+                outputQueued[node] += 1;        // The broadcast is queued too.
+            }
+
+            if (aOption == COMMS_ALL_RESET)
+            {
+                invalidateOutputLocks(node);    // Reset Outputs may have reverted to different locks.
+            }
+            
+            readOutputStates(node);
+        }
+    }
 }
 
 
@@ -159,9 +597,11 @@ void resetOutput()
         outputDef.printDef(M_DEBUG_RESET, outputPin);
     }
 
-    Wire.beginTransmission(I2C_OUTPUT_BASE_ID + outputNode);
+    beginOutputTransmission(outputNode);
     Wire.write(COMMS_CMD_RESET | outputPin);
-    Wire.endTransmission();
+    endOutputTransmission(outputNode);
+
+    invalidateOutputLocks(outputNode);
 
     // Reload the Output now it's been reset.
     readOutput(outputNode, outputPin);
@@ -170,17 +610,35 @@ void resetOutput()
 
 /** Read the states of the given node's Outputs.
  *  Save in OutputStates.
+ *  If the node's too busy, they're read later (see readDueOutputStates()).
  */
 void readOutputStates(uint8_t aNode)
 {
-    int states;
+    int     states  = -1;
+    int     status  = -1;
+    boolean present = isOutputNodePresent(aNode);
     
-    Wire.beginTransmission(I2C_OUTPUT_BASE_ID + aNode);
-    Wire.write(COMMS_CMD_SYSTEM | COMMS_SYS_STATES);
-    if (   (Wire.endTransmission() == 0)
-        && (Wire.requestFrom(I2C_OUTPUT_BASE_ID + aNode, OUTPUT_STATE_LEN) == OUTPUT_STATE_LEN)
-        && ((states = Wire.read()) >= 0))
+    // Only retry nodes that are present, absent ones are just being probed. Busy ones aren't failing.
+    for (uint8_t attempt = 0; (states < 0) && (status != COMMS_REPLY_BUSY) && (attempt <= (present ? HEALTH_RETRIES : 0)); attempt++)
     {
+        if (attempt > 0)
+        {
+            retryHealth(attempt - 1);
+        }
+        
+        beginOutputTransmission(aNode);
+        Wire.write(COMMS_CMD_SYSTEM | COMMS_SYS_STATES);
+        status = -1;
+        if (   (Wire.endTransmission() == 0)
+            && ((status = requestOutputResponse(aNode, OUTPUT_STATE_LEN)) == COMMS_REPLY_READY))
+        {
+            states = Wire.read();
+        }
+    }
+    
+    if (states >= 0)
+    {
+        recordHealthOk(HEALTH_OUTPUT(aNode));
         setOutputNodePresent(aNode, true);
         setOutputStates(aNode, states);
 
@@ -195,13 +653,72 @@ void readOutputStates(uint8_t aNode)
             Serial.println();
         }
     }
-    else
+    else if (status == COMMS_REPLY_BUSY)
     {
-        setOutputNodePresent(aNode, false);
+        outputStatesDue |= ((long)1 << aNode);      // Still working, read them later.
+    }
+    else if (present)
+    {
+        recordOutputError(aNode);
     }
 }
 
 
+/** Read the states of the first Output node that was too busy to report them.
+ *  Just one node each time, so Input scanning isn't held up.
+ */
+void readDueOutputStates()
+{
+    for (uint8_t node = 0; node < OUTPUT_NODE_MAX; node++)
+    {
+        if (outputStatesDue & ((long)1 << node))
+        {
+            outputStatesDue &= ~((long)1 << node);
+            if (isOutputNodePresent(node))
+            {
+                readOutputStates(node);             // Due again if it's still busy.
+            }
+            return;
+        }
+    }
+}
+
+
+/** Read the optional commands the given node supports.
+ *  The response never has a status byte, so it's read the same from all modules.
+ *  Save in outputCaps. Return true if the node responded.
+ */
+boolean readOutputCaps(uint8_t aNode)
+{
+    int caps = -1;
+    
+    Wire.beginTransmission(I2C_OUTPUT_BASE_ID + aNode);
+    Wire.write(COMMS_CMD_SYSTEM | COMMS_SYS_CAPS);
+    if (   (Wire.endTransmission() == 0)
+        && (Wire.requestFrom(I2C_OUTPUT_BASE_ID + aNode, OUTPUT_CAPS_LEN) == OUTPUT_CAPS_LEN))
+    {
+        caps = Wire.read();
+    }
+
+    outputCaps[aNode]   = caps > 0 ? caps : 0;  // Older modules return zero, no optional commands.
+    outputQueued[aNode] = 0;
+
+    if (   (caps >= 0)
+        && (isDebug(DEBUG_DETAIL)))
+    {
+        Serial.print(millis());
+        Serial.print(CHAR_TAB);
+        Serial.print(PGMT(M_DEBUG_CAPS));
+        Serial.print(aNode, HEX);
+        Serial.print(CHAR_SPACE);
+        Serial.print(caps, HEX);
+        Serial.println();
+    }
+
+    return caps >= 0;
+}
+
+
 /** Gets the states of all the given node's Outputs.
  */
 uint8_t getOutputStates(uint8_t aNode)
@@ -215,6 +732,17 @@ uint8_t getOutputStates(uint8_t aNode)
 void setOutputStates(uint8_t aNode, uint8_t aStates)
 {
     outputStates[aNode] = aStates;
+
+    // Changes waiting in the timeline are already committed, keep their states.
+    for (uint8_t index = 0; index < outputTimelineCount; index++)
+    {
+        if (outputTimeline[index].node == aNode)
+        {
+            setOutputState(aNode,
+                           outputTimeline[index].pinState & OUTPUT_PIN_MASK,
+                           (outputTimeline[index].pinState & OUTPUT_STATE_MASK) != 0);
+        }
+    }
 }
 
 
@@ -243,10 +771,29 @@ void setOutputState(uint8_t aNode, uint8_t aPin, boolean aState)
 }
 
 
+/** Record an error communicating with an Output node.
+ *  Only take the node offline once it's had too many errors.
+ */
+void recordOutputError(uint8_t aNode)
+{
+    if (recordHealthError(HEALTH_OUTPUT(aNode)))
+    {
+        systemFail(M_OUTPUT, aNode);
+        setOutputNodePresent(aNode, false);
+    }
+}
+
+
 /** Record the presence of an OutputNode in the map.
  */
 void setOutputNodePresent(uint8_t aNode, boolean aState)
 {
+    if (aState != isOutputNodePresent(aNode))
+    {
+        invalidateOutputLocks(aNode);
+        resetHealth(HEALTH_OUTPUT(aNode));
+    }
+    
     if (aState)
     {
         outputNodes |= ((long)1 << aNode);
@@ -265,3 +812,181 @@ boolean isOutputNodePresent(uint8_t aNode)
 {
     return (aNode < OUTPUT_NODE_MAX) && (outputNodes & ((long)1 << aNode));
 }
+
+
+/** Forget all the cached locks of the given node's Outputs.
+ *  Called whenever the node's Outputs may have changed.
+ */
+void invalidateOutputLocks(uint8_t aNode)
+{
+    outputLockGeneration[aNode] += 1;
+    outputLockKnown[aNode] = 0;
+    outputLockPins[aNode]  = 0;
+}
+
+
+/** Read and cache the locks of all the given node's Outputs.
+ */
+void readOutputLocks(uint8_t aNode)
+{
+    // Preserve the current Output.
+    uint8_t   node = outputNode;
+    uint8_t   pin  = outputPin;
+    OutputDef def  = outputDef;
+
+    for (uint8_t index = 0; index < OUTPUT_PIN_MAX; index++)
+    {
+        readOutput(aNode, index);       // Caches the Output's locks.
+    }
+
+    outputNode = node;
+    outputPin  = pin;
+    outputDef  = def;
+}
+
+
+/** Put the current Output's locks at the front of the cache.
+ */
+void cacheOutputLocks()
+{
+    uint8_t output = (outputNode << OUTPUT_NODE_SHIFT) | outputPin;
+    uint8_t mask   = 1 << outputPin;
+    uint8_t index  = 0;
+
+    outputLockKnown[outputNode] |= mask;
+
+    if (outputDef.getLocks() == 0)
+    {
+        // Nothing to cache, just remember the Output has no locks.
+        outputLockPins[outputNode] &= ~mask;
+    }
+    else
+    {
+        outputLockPins[outputNode] |= mask;
+
+        // Find the Output's existing entry, or use the least recently used one.
+        while (   (index < OUTPUT_LOCK_CACHE_SIZE - 1)
+               && (outputLockCache[index].output != output))
+        {
+            index += 1;
+        }
+
+        // Move more recent entries down.
+        for (; index > 0; index--)
+        {
+            outputLockCache[index] = outputLockCache[index - 1];
+        }
+
+        outputLockCache[0].output     = output;
+        outputLockCache[0].generation = outputLockGeneration[outputNode];
+
+        // Compile each direction's locks into a term per locking node.
+        for (uint8_t hi = 0; hi < 2; hi++)
+        {
+            OutputLockTerm* term  = outputLockCache[0].term[hi];
+            uint8_t         terms = 0;
+
+            for (uint8_t lock = 0; lock < OUTPUT_LOCK_MAX; lock++)
+            {
+                if (outputDef.isLock(hi, lock))
+                {
+                    uint8_t node = outputDef.getLockNode(hi, lock);
+                    uint8_t bit  = 1 << outputDef.getLockPin(hi, lock);
+
+                    // Find the node's term, or start a new one.
+                    index = 0;
+                    while (   (index < terms)
+                           && (term[index].node != node))
+                    {
+                        index += 1;
+                    }
+                    
+                    if (index == terms)
+                    {
+                        term[index].node = node;
+                        term[index].hi   = 0;
+                        term[index].lo   = 0;
+                        terms += 1;
+                    }
+
+                    if (outputDef.getLockState(hi, lock))
+                    {
+                        term[index].hi |= bit;
+                    }
+                    else
+                    {
+                        term[index].lo |= bit;
+                    }
+                }
+            }
+
+            outputLockCache[0].terms[hi] = terms;
+        }
+    }
+}
+
+
+/** Load the locks of the given Output, from the cache if possible.
+ *  Return true if the Output has locks, they'll be in the first cache entry.
+ */
+boolean loadOutputLocks(uint8_t aNode, uint8_t aPin)
+{
+    uint8_t output = (aNode << OUTPUT_NODE_SHIFT) | aPin;
+    uint8_t mask   = 1 << aPin;
+    uint8_t index  = 0;
+
+    if ((outputLockKnown[aNode] & mask) == 0)
+    {
+        readOutput(aNode, aPin);        // Caches the Output's locks (unless the node's absent).
+    }
+    else if (outputLockPins[aNode] & mask)
+    {
+        // Find the Output's entry.
+        while (   (index < OUTPUT_LOCK_CACHE_SIZE)
+               && (   (outputLockCache[index].output     != output)
+                   || (outputLockCache[index].generation != outputLockGeneration[aNode])))
+        {
+            index += 1;
+        }
+
+        if (index >= OUTPUT_LOCK_CACHE_SIZE)
+        {
+            readOutput(aNode, aPin);    // Evicted from the cache, so re-read it.
+        }
+        else if (index > 0)
+        {
+            // Move the entry to the front of the cache.
+            OutputLocks entry = outputLockCache[index];
+            for (; index > 0; index--)
+            {
+                outputLockCache[index] = outputLockCache[index - 1];
+            }
+            outputLockCache[0] = entry;
+        }
+    }
+
+    return (outputLockPins[aNode] & mask) != 0;
+}
+
+
+/** Find which of the first cache entry's locks prevent it being set to the given state.
+ *  Return the term's locking Outputs, or zero if not locked.
+ */
+uint8_t getOutputLocks(boolean aState, uint8_t &aNode)
+{
+    OutputLockTerm* term = outputLockCache[0].term[aState];
+
+    for (uint8_t index = 0; index < outputLockCache[0].terms[aState]; index++)
+    {
+        uint8_t states = outputStates[term[index].node];
+        uint8_t locked = (states & term[index].hi) | (~states & term[index].lo);
+        
+        if (locked)
+        {
+            aNode = term[index].node;
+            return locked;
+        }
+    }
+
+    return 0;
+}
@@ -14,6 +14,10 @@
 #define Report_h
 
 
+// Reports (REPORT_SHORT) waiting to be displayed, so the Outputs are actioned first.
+#define REPORT_QUEUE_MAX      4     // Number of reports that can be waiting, the oldest are lost.
+
+
 /** Is reporting enabled (at a particular level)?
  */
 boolean isReportEnabled(uint8_t aLevel);
@@ -29,4 +33,38 @@ int getReportDelay();
 void reportPause();
 
 
+/** Act on a button pressed while paused.
+ *  Adjust the report level (or configure), then show the (new) report level.
+ */
+void reportPauseButton(uint8_t aButton);
+
+
+/** Queue a report of an Input's change.
+ *  Its Outputs are added as they're actioned, until endReport().
+ */
+void queueReport(uint8_t aInput, uint8_t aType, boolean aState);
+
+
+/** Add an actioned Output to the report being filled.
+ *  Return false if no report is being filled.
+ */
+boolean reportOutput(uint8_t aNode, uint8_t aPin);
+
+
+/** Add a lock that prohibited the change to the report being filled.
+ *  Return false if no report is being filled.
+ */
+boolean reportLock(uint8_t aNode, uint8_t aPin, boolean aLockState, uint8_t aLockNode, uint8_t aLockPin);
+
+
+/** Finish filling the newest report.
+ */
+void endReport();
+
+
+/** Display all the waiting reports.
+ */
+void showReports();
+
+
 #endif
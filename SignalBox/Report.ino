@@ -13,11 +13,147 @@
 #include "All.h"
 
 
+// Reports (REPORT_SHORT) waiting to be displayed, oldest first.
+struct
+{
+    uint8_t input;                      // The Input's number.
+    uint8_t type;                       // The Input's type.
+    boolean state;                      // The Input's new state.
+    uint8_t count;                      // Number of Outputs actioned.
+    uint8_t outputs[INPUT_OUTPUT_MAX];  // The Outputs actioned.
+    boolean locked;                     // The change was prohibited by a lock.
+    boolean lockState;                  // The state of the Output that prohibited it.
+    uint8_t lock;                       // The Output that was to change.
+    uint8_t lockBy;                     // The Output that prohibited the change.
+} reportQueue[REPORT_QUEUE_MAX];
+
+uint8_t reportHead    = 0;              // Index of the oldest report.
+uint8_t reportCount   = 0;              // Number of reports waiting.
+boolean reportFilling = false;          // The newest report is still having its Outputs added.
+
+
 /** Is reporting enabled (at a particular level)?
  */
 boolean isReportEnabled(uint8_t aLevel)
 {
-    return aLevel <= systemData.reportLevel;
+    return    (!background)
+           && (aLevel <= systemData.reportLevel);
+}
+
+
+/** Queue a report of an Input's change.
+ *  Its Outputs are added as they're actioned, until endReport().
+ */
+void queueReport(uint8_t aInput, uint8_t aType, boolean aState)
+{
+    uint8_t index = 0;
+    
+    // Lose the oldest report if the queue is full.
+    if (reportCount >= REPORT_QUEUE_MAX)
+    {
+        reportHead   = (reportHead + 1) % REPORT_QUEUE_MAX;
+        reportCount -= 1;
+    }
+
+    index = (reportHead + reportCount) % REPORT_QUEUE_MAX;
+    reportQueue[index].input  = aInput;
+    reportQueue[index].type   = aType;
+    reportQueue[index].state  = aState;
+    reportQueue[index].count  = 0;
+    reportQueue[index].locked = false;
+    reportCount  += 1;
+    reportFilling = true;
+}
+
+
+/** Add an actioned Output to the report being filled.
+ *  Return false if no report is being filled.
+ */
+boolean reportOutput(uint8_t aNode, uint8_t aPin)
+{
+    if (reportFilling)
+    {
+        uint8_t index = (reportHead + reportCount - 1) % REPORT_QUEUE_MAX;
+
+        if (reportQueue[index].count < INPUT_OUTPUT_MAX)
+        {
+            reportQueue[index].outputs[reportQueue[index].count++] = (aNode << OUTPUT_NODE_SHIFT) | (aPin & OUTPUT_PIN_MASK);
+        }
+    }
+
+    return reportFilling;
+}
+
+
+/** Add a lock that prohibited the change to the report being filled.
+ *  Return false if no report is being filled.
+ */
+boolean reportLock(uint8_t aNode, uint8_t aPin, boolean aLockState, uint8_t aLockNode, uint8_t aLockPin)
+{
+    if (reportFilling)
+    {
+        uint8_t index = (reportHead + reportCount - 1) % REPORT_QUEUE_MAX;
+
+        reportQueue[index].locked    = true;
+        reportQueue[index].lockState = aLockState;
+        reportQueue[index].lock      = (aNode     << OUTPUT_NODE_SHIFT) | (aPin     & OUTPUT_PIN_MASK);
+        reportQueue[index].lockBy    = (aLockNode << OUTPUT_NODE_SHIFT) | (aLockPin & OUTPUT_PIN_MASK);
+    }
+
+    return reportFilling;
+}
+
+
+/** Finish filling the newest report.
+ */
+void endReport()
+{
+    reportFilling = false;
+}
+
+
+/** Display all the waiting reports.
+ *  Each replaces the one before, so the newest is left showing.
+ */
+void showReports()
+{
+    while (   (reportCount > 0)
+           && (   (!reportFilling)
+               || (reportCount > 1)))
+    {
+        uint8_t index = reportHead;
+        
+        reportHead   = (reportHead + 1) % REPORT_QUEUE_MAX;
+        reportCount -= 1;
+
+        disp.clearBottomRows();
+        disp.printProgStrAt(LCD_COL_START, LCD_ROW_EDT, M_INPUT_TYPES[reportQueue[index].type & INPUT_TYPE_MASK]);
+        disp.printProgStrAt(LCD_COL_STATE, LCD_ROW_EDT, (reportQueue[index].state ? M_HI : M_LO));
+        disp.printHexChAt(LCD_COL_NODE,    LCD_ROW_EDT, (reportQueue[index].input >> INPUT_NODE_SHIFT) & INPUT_NODE_MASK);
+        disp.printHexChAt(LCD_COL_PIN,     LCD_ROW_EDT, (reportQueue[index].input                    ) & INPUT_PIN_MASK);
+        disp.setCursor(LCD_COL_START + 1,  LCD_ROW_BOT);
+
+        for (uint8_t output = 0; output < reportQueue[index].count; output++)
+        {
+            disp.printCh(CHAR_SPACE);
+            disp.printHexCh((reportQueue[index].outputs[output] >> OUTPUT_NODE_SHIFT) & OUTPUT_NODE_MASK);
+            disp.printHexCh((reportQueue[index].outputs[output]                     ) & OUTPUT_PIN_MASK);
+        }
+
+        if (reportQueue[index].locked)
+        {
+            disp.printProgStrAt(LCD_COL_START, LCD_ROW_BOT, M_LOCK, LCD_LEN_OPTION);
+            disp.printCh(reportQueue[index].state ? CHAR_HI : CHAR_LO);
+            disp.printHexCh((reportQueue[index].lock   >> OUTPUT_NODE_SHIFT) & OUTPUT_NODE_MASK);
+            disp.printHexCh((reportQueue[index].lock                     ) & OUTPUT_PIN_MASK);
+            disp.printProgStr(M_VS);
+            disp.printCh(reportQueue[index].lockState ? CHAR_HI : CHAR_LO);
+            disp.printHexCh((reportQueue[index].lockBy >> OUTPUT_NODE_SHIFT) & OUTPUT_NODE_MASK);
+            disp.printHexCh((reportQueue[index].lockBy                     ) & OUTPUT_PIN_MASK);
+        }
+        
+        setDisplayTimeout(getReportDelay());
+    }
 }
 
 
@@ -36,29 +172,37 @@ void reportPause()
 {
     if (systemData.reportLevel >= REPORT_PAUSE)
     {
-        switch (waitForButtonPress())
-        {
-            case BUTTON_NONE:   break;
-            case BUTTON_UP:     systemData.reportLevel = REPORT_LONG;
-                                saveSystemData();
-                                break;
-            case BUTTON_DOWN:   systemData.reportLevel = REPORT_SHORT;
-                                saveSystemData();
-                                break;
-            case BUTTON_LEFT:   systemData.reportLevel = 0;
-                                saveSystemData();
-                                break;
-            case BUTTON_RIGHT:  configure.run();
-                                break;
-            case BUTTON_SELECT: break;
-        }
-
-        // Show (new) report level.
-        disp.clearRow(LCD_COL_START, LCD_ROW_BOT);
-        disp.printProgStrAt(LCD_COL_START,  LCD_ROW_BOT, M_REPORT);
-        disp.printProgStrAt(LCD_COL_REPORT_PARAM, LCD_ROW_BOT, M_REPORT_PROMPTS[systemData.reportLevel], LCD_LEN_OPTION);
-        
+        reportPauseButton(waitForButtonPress());
         waitForButtonRelease();
         disp.clearRow(LCD_COL_START, LCD_ROW_BOT);
     }
 }
+
+
+/** Act on a button pressed while paused.
+ *  Adjust the report level (or configure), then show the (new) report level.
+ */
+void reportPauseButton(uint8_t aButton)
+{
+    switch (aButton)
+    {
+        case BUTTON_NONE:   break;
+        case BUTTON_UP:     systemData.reportLevel = REPORT_LONG;
+                            saveSystemData();
+                            break;
+        case BUTTON_DOWN:   systemData.reportLevel = REPORT_SHORT;
+                            saveSystemData();
+                            break;
+        case BUTTON_LEFT:   systemData.reportLevel = 0;
+                            saveSystemData();
+                            break;
+        case BUTTON_RIGHT:  runConfigure();
+                            break;
+        case BUTTON_SELECT: break;
+    }
+
+    // Show (new) report level.
+    disp.clearRow(LCD_COL_START, LCD_ROW_BOT);
+    disp.printProgStrAt(LCD_COL_START,  LCD_ROW_BOT, M_REPORT);
+    disp.printProgStrAt(LCD_COL_REPORT_PARAM, LCD_ROW_BOT, M_REPORT_PROMPTS[systemData.reportLevel], LCD_LEN_OPTION);
+}
@@ -14,9 +14,23 @@
 #define SignalBox_h
 
 
+#include "Health.h"                             // Master only, so not in All.h (which is common to both sketches).
+
+
+// Probing for hardware.
+#define HARDWARE_PROBE_MAX   (INPUT_NODE_MAX + OUTPUT_NODE_MAX) // Number of addresses to probe.
+#define HARDWARE_BACKOFF_MAX    4       // Empty addresses are probed at least every 2^4 rounds.
+#define HARDWARE_BACKOFF_SHIFT  5       // Backoff exponent in the top 3 bits.
+#define HARDWARE_COUNT_MASK  0x1f       // Rounds until the next probe in the bottom 5 bits.
+
+
 // Record state of input switches. Referenced by Configure object.
 uint16_t currentSwitchState[INPUT_NODE_MAX];    // Current state of inputs.
 
+boolean  configuring = false;                   // Configuration is in progress.
+boolean  background  = false;                   // The layout is being operated in the background of configuration.
+boolean  selecting   = false;                   // Configuration is scanning the Inputs to select one, so they're not actioned.
+
 
 /** Is an LCD shield present?
  */
@@ -32,14 +46,23 @@ void scanHardware();
  *  Return the state of the pins, 16 bits, both ports.
  *  Return current state if there's a communication error, 
  *  this will prevent any actions being performed.
+ *  aFlagged indicates the interrupt flags have already been read.
  */
-uint16_t readInputNode(uint8_t aNode);
+uint16_t readInputNode(uint8_t aNode, boolean aFlagged);
+
+
+/** Delay for an interval.
+ *  If configuring, keep the layout operating meanwhile.
+ *  The Input and Output being configured are preserved, and reporting is suppressed so the menus aren't disturbed.
+ */
+void delayOperating(long aInterval);
 
 
 /** Scan all the Inputs.
  *  Parameter indicates if Configuration is in progress.
+ *  Return true if any Input has started to change.
  */
-void scanInputs(boolean aConfiguration);
+boolean scanInputs(boolean aConfiguration);
 
 
 /** Process all the Input's Outputs.
@@ -53,6 +76,11 @@ void processInputOutputs(boolean aNewState);
 uint8_t processInputOutput(uint8_t aIndex, uint8_t aState, uint8_t aDelay);
 
 
+/** Run the Configuration menus.
+ */
+void runConfigure();
+
+
 /** Send a command to an output node.
  *  Return error code if any.
  *  Forward reference required for Configure class.
@@ -17,21 +17,78 @@
 
 
 #define COMMAND_BUFFER_LEN   8                  // Serial command buffer length
-char    commandBuffer[COMMAND_BUFFER_LEN + 1];  // Buffer to read characters with null terminator on the end.
-uint8_t commandLen = 0;                         // Length of command.
+#define COMMAND_RESULT_MAX  16                  // Most results acknowledged on one line.
+char     commandBuffer[COMMAND_BUFFER_LEN + 1]; // Buffer to read characters with null terminator on the end.
+uint8_t  commandLen = 0;                        // Length of command.
+char     commandResults[COMMAND_RESULT_MAX + 1];// Results of the commands waiting to be acknowledged.
+uint8_t  commandResultLen = 0;                  // Number of results waiting.
+uint8_t  commandOutputs[COMMAND_RESULT_MAX];    // Output (node * OUTPUT_PIN_MAX + pin) of each result waiting for its state.
+uint16_t commandSequence  = 0;                  // Sequence number of the first result waiting.
+
+
+// Interrupt capture from the last Input node read.
+uint16_t inputCaptureFlags = 0;     // The pins that caused an interrupt (INTFA/B).
+uint16_t inputCaptureState = 0;     // The state of the pins when the interrupt occurred (INTCAPA/B).
+
+
+// Queue of Input changes waiting to be actioned.
+struct
+{
+    uint8_t input;                  // The Input's number.
+    boolean state;                  // The Input's new state.
+    long    tick;                   // When the change was detected.
+} inputEvents[INPUT_EVENT_MAX];
+
+uint8_t  inputEventHead  = 0;       // Index of the oldest event.
+uint8_t  inputEventCount = 0;       // Number of events in the queue.
+uint8_t  inputEventPeak  = 0;       // Greatest number of events there have been in the queue.
+uint16_t inputEventLost  = 0;       // Number of events lost because the queue was full.
+
+
+// An Input whose Outputs are being stepped through, one for each button press (REPORT_PAUSE).
+#define PAUSE_NONE          -1      // No Input is paused.
+
+struct
+{
+    int8_t   index;                 // Index of the paused Input's next Output, or PAUSE_NONE.
+    boolean  state;                 // The state its Outputs are being set to.
+    uint8_t  delay;                 // Delay accumulated so far.
+    uint8_t  input;                 // The paused Input's number.
+    InputDef def;                   // The paused Input's definition.
+} pausedInput = { PAUSE_NONE };
+
+uint8_t loopButton   = BUTTON_NONE; // Button pressed when the buttons were last read.
+boolean pauseStepped = false;       // The last button press stepped the paused Input.
 
 
 // Ticking
-long    now              = 0;       // The current time in millisecs.
-long    tickHardwareScan = 0;       // The time of the last scan for hardware.
-long    tickInputScan    = 0;       // The time of the last scan of input switches.
-long    tickHeartBeat    = 0;       // Time of last heartbeat.
+long    now               = 0;      // The current time in millisecs.
+long    tickHardwareScan  = 0;      // The time of the last probe for hardware.
+long    tickHardwareRound = 0;      // The time the next round of probes for hardware can start.
+long    tickInputScan     = 0;      // The time of the last scan of input switches.
+long    tickInputPoll     = 0;      // The time of the last scan of all input switches when using interrupts.
+long    tickHeartBeat     = 0;      // Time of last heartbeat.
+long    tickButton        = 0;      // Time the buttons were last read.
+
+// Stack headroom, the free RAM the stack has never reached.
+#define STACK_PAINT        0xc5     // Painted over free RAM at start-up, the stack overwrites it as it grows.
+uint16_t stackHeadroom = 0xffff;    // Least headroom reported so far.
+extern uint8_t  __heap_start;       // Start of the heap, just after the globals (from the linker).
+extern uint8_t *__brkval;           // Top of the heap, zero if it's never been used (from malloc).
 
 long    displayTimeout   = 1L;      // Timeout for the display when important messages are showing.
                                     // Using 1 forces an initial redisplay unless a start-up process has requested a delay.
 
 boolean lcdShield = LCD_SHIELD;     // An LCD shield is present.
 
+boolean inputInterrupts = INPUT_INTERRUPT_PIN != 0;     // Input nodes' INT pins are wired to the INPUT_INTERRUPT_PIN.
+uint8_t inputInterruptMisses = 0;                       // Consecutive fallback scans that found changes without an interrupt.
+
+
+// Probing for hardware.
+uint8_t hardwareProbe = 0;                          // Next address to probe.
+uint8_t hardwareBackoff[HARDWARE_PROBE_MAX];        // Backoff of each address.
+
 
 /** Is an LCD shield present?
  */
@@ -68,31 +125,41 @@ void scanInputHardware()
     {
         if (!isInputNodePresent(node))
         {
-            if (disp.getLcdId() != (I2C_INPUT_BASE_ID + node))
+            probeInputNode(node);
+        }
+    }
+}
+
+
+/** See if an (absent) Input node responds.
+ *  If it does, configure it for input.
+ */
+void probeInputNode(uint8_t aNode)
+{
+    if (disp.getLcdId() != (I2C_INPUT_BASE_ID + aNode))
+    {
+        // Send message to the Input and see if it responds.
+        Wire.beginTransmission(I2C_INPUT_BASE_ID + aNode);
+        if (Wire.endTransmission() == 0)
+        {
+            setInputNodePresent(aNode, true);
+            resetInputDebounce(aNode);
+
+            // Configure MCP for input.
+            for (uint8_t command = 0; command < INPUT_COMMANDS_LEN; command++)
             {
-                // Send message to the Input and see if it responds.
-                Wire.beginTransmission(I2C_INPUT_BASE_ID + node);
-                if (Wire.endTransmission() == 0)
-                {
-                    setInputNodePresent(node, true);
-
-                    // Configure MCP for input.
-                    for (uint8_t command = 0; command < INPUT_COMMANDS_LEN; command++)
-                    {
-                        Wire.beginTransmission(I2C_INPUT_BASE_ID + node); 
-                        Wire.write(INPUT_COMMANDS[command]);
-                        Wire.write(MCP_ALL_HIGH);
-                        Wire.endTransmission();
-                    }
-        
-                    // Record current switch state
-                    currentSwitchState[node] = readInputNode(node);
-                }
-                else
-                {
-                    currentSwitchState[node] = 0xffff;
-                }
+                Wire.beginTransmission(I2C_INPUT_BASE_ID + aNode); 
+                Wire.write(INPUT_COMMANDS[command][0]);
+                Wire.write(INPUT_COMMANDS[command][1]);
+                Wire.endTransmission();
             }
+
+            // Record current switch state
+            currentSwitchState[aNode] = readInputNode(aNode, false);
+        }
+        else
+        {
+            currentSwitchState[aNode] = 0xffff;
         }
     }
 }
@@ -139,7 +206,107 @@ void scanOutputHardware()
     {
         if (!isOutputNodePresent(node))
         {
-            readOutputStates(node);     // Automatically marked as present if it responds.
+            probeOutputNode(node);
+        }
+    }
+}
+
+
+/** See if an (absent) Output node responds.
+ *  If it does, find what it supports, read its states and cache its locks.
+ */
+void probeOutputNode(uint8_t aNode)
+{
+    // Capabilities first, they're read the same from all modules and say how to read everything else.
+    if (readOutputCaps(aNode))
+    {
+        readOutputStates(aNode);        // Automatically marked as present if it responds.
+
+        if (isOutputNodePresent(aNode))
+        {
+            readOutputLocks(aNode);     // Cache the new node's locks so they needn't be read when Inputs change.
+        }
+    }
+}
+
+
+/** Probe the next absent hardware address, round-robin through the Input nodes then the Output nodes.
+ *  Only one address is probed each time so Input scanning isn't held up.
+ *  A round starts every STEP_HARDWARE_ROUND, and ends once every address has been visited.
+ *  Addresses that stay empty are probed exponentially less often (counted down once per round),
+ *  they're passed over without using up the probe.
+ */
+void probeHardware()
+{
+    if (   (hardwareProbe == 0)
+        && (now < tickHardwareRound))
+    {
+        return;                                     // Wait for the next round.
+    }
+    else if (hardwareProbe == 0)
+    {
+        tickHardwareRound = now + STEP_HARDWARE_ROUND;
+    }
+
+    while (hardwareProbe < HARDWARE_PROBE_MAX)
+    {
+        uint8_t probe   = hardwareProbe++;
+        boolean present = false;
+
+        if (probe < INPUT_NODE_MAX)
+        {
+            present = isInputNodePresent(probe);
+        }
+        else
+        {
+            present = isOutputNodePresent(probe - INPUT_NODE_MAX);
+        }
+
+        if (present)
+        {
+            hardwareBackoff[probe] = 0;             // Probe promptly if it disappears.
+        }
+        else if (hardwareBackoff[probe] & HARDWARE_COUNT_MASK)
+        {
+            // Not yet, try the next address.
+        }
+        else
+        {
+            if (probe < INPUT_NODE_MAX)
+            {
+                probeInputNode(probe);
+                present = isInputNodePresent(probe);
+            }
+            else
+            {
+                probeOutputNode(probe - INPUT_NODE_MAX);
+                present = isOutputNodePresent(probe - INPUT_NODE_MAX);
+            }
+
+            if (!present)
+            {
+                // Still empty, so back off.
+                uint8_t backoff = hardwareBackoff[probe] >> HARDWARE_BACKOFF_SHIFT;
+                if (backoff < HARDWARE_BACKOFF_MAX)
+                {
+                    backoff += 1;
+                }
+                hardwareBackoff[probe] = (backoff << HARDWARE_BACKOFF_SHIFT) | (1 << backoff);
+            }
+            break;
+        }
+    }
+
+    if (hardwareProbe >= HARDWARE_PROBE_MAX)
+    {
+        // End of the round, count down the addresses backing off.
+        hardwareProbe = 0;
+        for (uint8_t probe = 0; probe < HARDWARE_PROBE_MAX; probe++)
+        {
+            if (hardwareBackoff[probe] & HARDWARE_COUNT_MASK)
+            {
+                hardwareBackoff[probe] -= 1;
+            }
         }
     }
 }
@@ -323,13 +490,26 @@ void ezyBusConvert()
  */
 void sendDebugLevel()
 {
+    // One broadcast for all the nodes that support it.
+    Wire.beginTransmission(I2C_BROADCAST_ID);
+    Wire.write(COMMS_CMD_DEBUG | (getDebug() & COMMS_OPTION_MASK));
+    Wire.endTransmission();
+
     for (uint8_t node = 0; node < OUTPUT_NODE_MAX; node++)
     {
         if (isOutputNodePresent(node))
         {
-            Wire.beginTransmission(I2C_OUTPUT_BASE_ID + node);
-            Wire.write(COMMS_CMD_DEBUG | (getDebug() & COMMS_OPTION_MASK));
-            Wire.endTransmission();
+            // Older modules don't receive broadcasts, so send to each of them.
+            if ((outputCaps[node] & COMMS_CAP_BROADCAST) == 0)
+            {
+                Wire.beginTransmission(I2C_OUTPUT_BASE_ID + node);
+                Wire.write(COMMS_CMD_DEBUG | (getDebug() & COMMS_OPTION_MASK));
+                Wire.endTransmission();
+            }
+            else
+            {
+                outputQueued[node] += 1;        // The broadcast is queued too.
+            }
 
             if (isDebug(DEBUG_BRIEF))
             {
@@ -349,51 +529,204 @@ void sendDebugLevel()
 
 /** Scan all the Inputs.
  *  Parameter indicates if Configuration is in progress.
+ *  Return true if any Input has started to change.
  */
-void scanInputs(boolean aConfiguration)
+boolean scanInputs(boolean aConfiguration)
 { 
+    boolean changed = false;
+
     // Scan all the nodes. 
     for (uint8_t node = 0; node < INPUT_NODE_MAX; node++)
     {
         if (isInputNodePresent(node))                                        
         {
-            // Read current state of pins and if there's been a change.
-            uint16_t pins = readInputNode(node);
-            if (pins != currentSwitchState[node])
+            changed |= scanInputNode(node, aConfiguration, false);
+        }
+    }
+
+    return changed;
+}
+
+
+/** Scan the Inputs that are being debounced, or have signalled a change on the INPUT_INTERRUPT_PIN.
+ *  Only nodes with interrupt flags set have their pins read, carrying on from the flags.
+ */
+void scanInputInterrupts(boolean aInterrupt)
+{
+    for (uint8_t node = 0; node < INPUT_NODE_MAX; node++)
+    {
+        if (isInputNodePresent(node))
+        {
+            if (inputDebounce[node].isDebouncing())
             {
-                // Process all the changed pins.
-                for (uint16_t pin = 0, mask = 1; pin < INPUT_PIN_MAX; pin++, mask <<= 1)
+                scanInputNode(node, false, false);
+            }
+            else if (aInterrupt)
+            {
+                inputCaptureFlags = readInputFlags(node);
+                if (inputCaptureFlags)
                 {
-                    uint16_t state = pins & mask;
-                    if (state != (currentSwitchState[node] & mask))
-                    {
-                        // Ensure Input is loaded and handle the action.
-                        loadInput(node, pin);
-                        if (aConfiguration)
-                        {
-                            configure.displaySelectedInput(node, pin);  // Configuring is in progress, display the input actioned.
-                        }
-                        else
-                        {
-                            processInput(state != 0);                   // Normal processing, action the input.
-                        }
-                    }
+                    scanInputNode(node, false, true);
                 }
-            
-                // Record new input states.
-                currentSwitchState[node] = pins;
             }
         }
     }
 }
 
 
+/** Scan an Input node's pins.
+ *  Parameter indicates if Configuration is in progress.
+ *  aFlagged indicates the node's interrupt flags have just been read (into inputCaptureFlags).
+ *  Return true if any of the node's Inputs have started to change.
+ */
+boolean scanInputNode(uint8_t aNode, boolean aConfiguration, boolean aFlagged)
+{
+    // Read current state of pins and debounce them.
+    uint16_t sample   = readInputNode(aNode, aFlagged);
+    uint16_t previous = currentSwitchState[aNode];
+    boolean  started  = (sample != previous) && !inputDebounce[aNode].isDebouncing();
+
+#if INPUT_CAPTURE
+    // Pins that interrupted in a different state, they may have changed back since, ie pressed and released between scans.
+    inputDebounce[aNode].capture(inputCaptureFlags & (inputCaptureState ^ previous));
+#endif
+
+    uint16_t pins     = inputDebounce[aNode].debounce(sample, previous);
+
+    if (pins == previous)
+    {
+        return started;
+    }
+
+    // Process all the changed pins.
+    for (uint16_t pin = 0, mask = 1; pin < INPUT_PIN_MAX; pin++, mask <<= 1)
+    {
+        uint16_t state = pins & mask;
+        if (state != (previous & mask))
+        {
+            // Handle the action.
+            if (aConfiguration)
+            {
+                loadInput(aNode, pin);
+                configure.displaySelectedInput(aNode, pin); // Configuring is in progress, display the input actioned.
+            }
+            else
+            {
+                uint8_t input = ((aNode & INPUT_NODE_MASK) << INPUT_NODE_SHIFT) | pin;
+                queueInputEvent(input, state != 0);         // Normal processing, queue the input to be actioned.
+            }
+        }
+    }
+
+    // Record new input states.
+    currentSwitchState[aNode] = pins;
+
+    return started;
+}
+
+
+/** Queue an Input's change of state to be actioned.
+ *  The change is lost if the queue is full.
+ */
+void queueInputEvent(uint8_t aInput, boolean aState)
+{
+    if (inputEventCount >= INPUT_EVENT_MAX)
+    {
+        inputEventLost += 1;
+
+        if (isDebug(DEBUG_ERRORS))
+        {
+            Serial.print(millis());
+            Serial.print(CHAR_TAB);
+            Serial.print(PGMT(M_DEBUG_EVENT));
+            Serial.print(PGMT(M_DEBUG_NODE));
+            Serial.print((aInput >> INPUT_NODE_SHIFT) & INPUT_NODE_MASK, HEX);
+            Serial.print(PGMT(M_DEBUG_PIN));
+            Serial.print((aInput                    ) & INPUT_PIN_MASK,  HEX);
+            Serial.print(PGMT(M_DEBUG_LOST));
+            Serial.print(inputEventLost);
+            Serial.println();
+        }
+    }
+    else
+    {
+        uint8_t index = (inputEventHead + inputEventCount) % INPUT_EVENT_MAX;
+
+        inputEvents[index].input = aInput;
+        inputEvents[index].state = aState;
+        inputEvents[index].tick  = millis();
+
+        inputEventCount += 1;
+        if (inputEventCount > inputEventPeak)
+        {
+            inputEventPeak = inputEventCount;
+        }
+    }
+}
+
+
+/** Action the oldest queued Input change, if there is one.
+ */
+void dispatchInputEvent()
+{
+    if (inputEventCount > 0)
+    {
+        uint8_t index = inputEventHead;
+
+        inputEventHead   = (inputEventHead + 1) % INPUT_EVENT_MAX;
+        inputEventCount -= 1;
+
+        if (isDebug(DEBUG_DETAIL))
+        {
+            Serial.print(millis());
+            Serial.print(CHAR_TAB);
+            Serial.print(PGMT(M_DEBUG_EVENT));
+            Serial.print(PGMT(M_DEBUG_NODE));
+            Serial.print((inputEvents[index].input >> INPUT_NODE_SHIFT) & INPUT_NODE_MASK, HEX);
+            Serial.print(PGMT(M_DEBUG_PIN));
+            Serial.print((inputEvents[index].input                    ) & INPUT_PIN_MASK,  HEX);
+            Serial.print(PGMT(M_DEBUG_STATE));
+            Serial.print(PGMT(inputEvents[index].state ? M_HI : M_LO));
+            Serial.print(PGMT(M_DEBUG_AGE));
+            Serial.print(millis() - inputEvents[index].tick);
+            Serial.print(PGMT(M_DEBUG_QUEUE));
+            Serial.print(inputEventCount);
+            Serial.print(PGMT(M_DEBUG_PEAK));
+            Serial.print(inputEventPeak);
+            Serial.print(PGMT(M_DEBUG_LOST));
+            Serial.print(inputEventLost);
+            Serial.println();
+        }
+
+        loadInput(inputEvents[index].input);
+        processInput(inputEvents[index].state);
+    }
+}
+
+
+/** Has any Input node signalled a change on the INPUT_INTERRUPT_PIN?
+ *  The nodes' INT pins are open-drain, so any of them can pull it low.
+ */
+boolean isInputInterrupt()
+{
+#if INPUT_INTERRUPT_PIN
+    return !digitalRead(INPUT_INTERRUPT_PIN);
+#else
+    return false;
+#endif
+}
+
+
 /** Record a node input error.
+ *  Only take the node offline once it's had too many errors.
  */
 void recordInputError(uint8_t aNode)
 {
-    systemFail(M_INPUT, aNode);
-    setInputNodePresent(aNode, false);
+    if (recordHealthError(HEALTH_INPUT(aNode)))
+    {
+        systemFail(M_INPUT, aNode);
+        setInputNodePresent(aNode, false);
+    }
 }
 
 
@@ -401,21 +734,97 @@ void recordInputError(uint8_t aNode)
  *  Return the state of the pins, 16 bits, both ports.
  *  Return current state if there's a communication error, 
  *  this will prevent any actions being performed.
+ *  If INPUT_CAPTURE, record the interrupt flags and captured state too.
+ *  aFlagged indicates the interrupt flags have already been read, so they're not read again.
  */
-uint16_t readInputNode(uint8_t aNode)
+uint16_t readInputNode(uint8_t aNode, boolean aFlagged)
 {
-    uint16_t value = 0;
+    uint16_t value  = 0;
+    boolean  ok     = false;
+    uint8_t  start  = MCP_GPIOA;
+    int      length = INPUT_STATE_LEN;
+
+#if INPUT_CAPTURE
+    // Registers are read sequentially, INTF, INTCAP then GPIO.
+    start  = aFlagged ? MCP_INTCAPA : MCP_INTFA;
+    length = aFlagged ? INPUT_CAPTURE_LEN - INPUT_FLAGS_LEN : INPUT_CAPTURE_LEN;
+#endif
 
-    Wire.beginTransmission(I2C_INPUT_BASE_ID + aNode);    
-    Wire.write(MCP_GPIOA);
-    if (   (Wire.endTransmission())
-        || (Wire.requestFrom(I2C_INPUT_BASE_ID + aNode, INPUT_STATE_LEN) != INPUT_STATE_LEN))
+    // Flags are only kept if they'll be used with the captured state.
+    if (   (!aFlagged)
+        || (!INPUT_CAPTURE))
+    {
+        inputCaptureFlags = 0;
+    }
+
+    for (uint8_t attempt = 0; (!ok) && (attempt <= HEALTH_RETRIES); attempt++)
+    {
+        if (attempt > 0)
+        {
+            retryHealth(attempt - 1);
+        }
+        
+        Wire.beginTransmission(I2C_INPUT_BASE_ID + aNode);    
+        Wire.write(start);
+        ok =    (Wire.endTransmission() == 0)
+             && (Wire.requestFrom(I2C_INPUT_BASE_ID + aNode, length) == length);
+    }
+    
+    if (!ok)
     {
         recordInputError(aNode);
         value = currentSwitchState[aNode];  // Pretend no change if comms error.
+        inputCaptureFlags = 0;
+    }
+    else
+    {
+        recordHealthOk(HEALTH_INPUT(aNode));
+#if INPUT_CAPTURE
+        if (!aFlagged)
+        {
+            inputCaptureFlags = Wire.read()
+                              + (Wire.read() << 8);
+        }
+        inputCaptureState = Wire.read()
+                          + (Wire.read() << 8);
+#endif
+        value = Wire.read()
+              + (Wire.read() << 8);
+    }
+
+    return value;
+}
+
+
+/** Read the interrupt flags of an InputNode.
+ *  Return the pins that have changed, 16 bits, both ports.
+ *  Return zero if there's a communication error.
+ */
+uint16_t readInputFlags(uint8_t aNode)
+{
+    uint16_t value = 0;
+    boolean  ok    = false;
+
+    for (uint8_t attempt = 0; (!ok) && (attempt <= HEALTH_RETRIES); attempt++)
+    {
+        if (attempt > 0)
+        {
+            retryHealth(attempt - 1);
+        }
+        
+        Wire.beginTransmission(I2C_INPUT_BASE_ID + aNode);    
+        Wire.write(MCP_INTFA);
+        ok =    (Wire.endTransmission() == 0)
+             && (Wire.requestFrom(I2C_INPUT_BASE_ID + aNode, INPUT_FLAGS_LEN) == INPUT_FLAGS_LEN);
+    }
+    
+    if (!ok)
+    {
+        recordInputError(aNode);
     }
     else
     {
+        recordHealthOk(HEALTH_INPUT(aNode));
         value = Wire.read()
               + (Wire.read() << 8);
     }
@@ -452,15 +861,15 @@ void processInput(boolean aState)
         }
 
         // Report state change if reporting enabled.
+        // Displayed once the Outputs have been actioned, unless pausing when it's needed straight away.
         if (isReportEnabled(REPORT_SHORT))
         {
-            disp.clearBottomRows();
-            disp.printProgStrAt(LCD_COL_START, LCD_ROW_EDT, M_INPUT_TYPES[inputType & INPUT_TYPE_MASK]);
-            disp.printProgStrAt(LCD_COL_STATE, LCD_ROW_EDT, (newState ? M_HI : M_LO));
-            disp.printHexChAt(LCD_COL_NODE,    LCD_ROW_EDT, (inputNumber >> INPUT_NODE_SHIFT) & INPUT_NODE_MASK);
-            disp.printHexChAt(LCD_COL_PIN,     LCD_ROW_EDT, (inputNumber                    ) & INPUT_PIN_MASK);
-            disp.setCursor(LCD_COL_START + 1,  LCD_ROW_BOT);
-            setDisplayTimeout(getReportDelay());
+            queueReport(inputNumber, inputType, newState);
+            if (isReportEnabled(REPORT_PAUSE))
+            {
+                endReport();
+                showReports();
+            }
 
             if (isDebug(DEBUG_BRIEF))
             {
@@ -483,56 +892,64 @@ void processInput(boolean aState)
         {
             processInputOutputs(newState);
         }
+        endReport();
     }
 }
 
 
 
 /** Check if any of the Input's Outputs are locked.
+ *  Uses the cached, compiled, locks, so normally no need to read the Outputs.
  */
 boolean isLocked(boolean aNewState)
 {
     // Check all the Input's Outputs.
     for (uint8_t inpIndex = 0; inpIndex < INPUT_OUTPUT_MAX; inpIndex++)
     {
-        // Process all definitions that aren't "delay"s.
-        if (!inputDef.isDelay(inpIndex))
-        {
-            readOutput(inputDef.getOutputNode(inpIndex), inputDef.getOutputPin(inpIndex));
+        // Process all definitions that aren't "delay"s (and have locks).
+        uint8_t node = inputDef.getOutputNode(inpIndex);
+        uint8_t pin  = inputDef.getOutputPin(inpIndex);
 
-            // Check all the Output's locks.
-            for (uint8_t outIndex = 0; outIndex < OUTPUT_LOCK_MAX; outIndex++)
+        if (   (!inputDef.isDelay(inpIndex))
+            && (loadOutputLocks(node, pin)))
+        {
+            // Check the Output's compiled locks against the states of all the Outputs.
+            uint8_t lockNode = 0;
+            uint8_t locked   = getOutputLocks(aNewState, lockNode);
+            
+            if (locked)
             {
-                // If there's an active lock
-                if (outputDef.isLock(aNewState, outIndex))
+                // Report the first Output that prohibits the state change.
+                uint8_t lockPin = 0;
+                while (!(locked & (1 << lockPin)))
+                {
+                    lockPin += 1;
+                }
+                boolean state = getOutputState(lockNode, lockPin);
+
+                if (   (isReportEnabled(REPORT_SHORT))
+                    && (!reportLock(node, pin, state, lockNode, lockPin)))
                 {
-                    // And the state change is prohibited.
-                    boolean state = getOutputState(outputDef.getLockNode(aNewState, outIndex), outputDef.getLockPin(aNewState, outIndex));
-                    if (outputDef.getLockState(aNewState, outIndex) == state)
-                    {
-                        if (isReportEnabled(REPORT_SHORT))
-                        {
-                            disp.printProgStrAt(LCD_COL_START, LCD_ROW_BOT, M_LOCK, LCD_LEN_OPTION);
-                            disp.printCh(aNewState ? CHAR_HI : CHAR_LO);
-                            disp.printHexCh(outputNode);
-                            disp.printHexCh(outputPin);
-                            disp.printProgStr(M_VS);
-                            disp.printCh(state ? CHAR_HI : CHAR_LO);
-                            disp.printHexCh(outputDef.getLockNode(aNewState, outIndex));
-                            disp.printHexCh(outputDef.getLockPin (aNewState, outIndex));
-                            setDisplayTimeout(getReportDelay());
-                        }
-
-                        if (isDebug(DEBUG_BRIEF))
-                        {
-                            outputDef.printDef(M_LOCK, outputPin);
-                            readOutput(outputDef.getLockNode(aNewState, outIndex), outputDef.getLockPin(aNewState, outIndex));
-                            outputDef.printDef(M_VS, outputPin);
-                        }
-                        
-                        return true;            // A lock exists.
-                    }
+                    disp.printProgStrAt(LCD_COL_START, LCD_ROW_BOT, M_LOCK, LCD_LEN_OPTION);
+                    disp.printCh(aNewState ? CHAR_HI : CHAR_LO);
+                    disp.printHexCh(node);
+                    disp.printHexCh(pin);
+                    disp.printProgStr(M_VS);
+                    disp.printCh(state ? CHAR_HI : CHAR_LO);
+                    disp.printHexCh(lockNode);
+                    disp.printHexCh(lockPin);
+                    setDisplayTimeout(getReportDelay());
                 }
+
+                if (isDebug(DEBUG_BRIEF))
+                {
+                    readOutput(node, pin);
+                    outputDef.printDef(M_LOCK, pin);
+                    readOutput(lockNode, lockPin);
+                    outputDef.printDef(M_VS, lockPin);
+                }
+                
+                return true;            // A lock exists.
             }
         }
     }
@@ -546,6 +963,16 @@ boolean isLocked(boolean aNewState)
 void processInputOutputs(boolean aNewState)
 {
     uint8_t endDelay = 0;
+
+    // Pausing (outside of Configuration), so step through the Outputs as buttons are pressed.
+    // Only one Input can be paused, others are actioned as they occur.
+    if (   (isReportEnabled(REPORT_PAUSE))
+        && (!configuring)
+        && (pausedInput.index == PAUSE_NONE))
+    {
+        startPausedInput(aNewState);
+        return;
+    }
     
     // Process all the Input's outputs.
     // In reverse order if setting lo.
@@ -563,6 +990,9 @@ void processInputOutputs(boolean aNewState)
             endDelay = processInputOutput(index, aNewState, endDelay);
         }
     }
+
+    // Send the changes, one batch for each node.
+    sendOutputBatch();
 }
 
 
@@ -588,23 +1018,16 @@ uint8_t processInputOutput(uint8_t aIndex, uint8_t aState, uint8_t aDelay)
 //            || (   (isReportEnabled(REPORT_SHORT))
 //                && (inputDef.getOutputCount() <= 1)))
         {
-            readOutput(inputDef.getOutput(aIndex));
-            disp.printProgStrAt(LCD_COL_START,  LCD_ROW_BOT, M_OUTPUT_TYPES[outputDef.getType()], LCD_COLS);
-            disp.printHexChAt(LCD_COL_OUTPUT_PARAM, LCD_ROW_BOT, outNode);
-            disp.printHexCh(outPin);
-            disp.printCh(CHAR_SPACE);
-            disp.printHexCh(outputDef.getPace());
-            disp.printCh(CHAR_SPACE);
-            disp.printCh(outputDef.getResetCh());
-            disp.setCursor(-2, LCD_ROW_BOT);
-            disp.printDec(aDelay, 2, CHAR_SPACE);
+            displayInputOutput(inputDef.getOutput(aIndex), aDelay);
             
-//            if (isReportEnabled(REPORT_PAUSE))
+            // Configuration's tests wait here, otherwise see stepPausedInput().
+            if (configuring)
             {
                 reportPause();
             }
         }
-        else if (isReportEnabled(REPORT_SHORT))
+        else if (   (isReportEnabled(REPORT_SHORT))
+                 && (!reportOutput(outNode, outPin)))
         {
             disp.printCh(CHAR_SPACE);
             disp.printHexCh(outNode);
@@ -629,10 +1052,15 @@ uint8_t processInputOutput(uint8_t aIndex, uint8_t aState, uint8_t aDelay)
         }
 
         // Action the Output state change.
-        writeOutputState(outNode, outPin, aState, endDelay);
-
-        // Recover all states from output module (in case a double-LED has changed one).
-        readOutputStates(outNode);
+        // And recover all states from output module (in case a double-LED has changed one).
+        if (isReportEnabled(REPORT_PAUSE))
+        {
+            writeReadOutputState(outNode, outPin, aState, endDelay);    // Immediately, so the change can be seen.
+        }
+        else
+        {
+            scheduleOutputState(outNode, outPin, aState, endDelay);     // Sent together, when due, once all the Outputs are processed.
+        }
         // setOutputState(outNode, outPin, aState);
     }
 
@@ -640,16 +1068,137 @@ uint8_t processInputOutput(uint8_t aIndex, uint8_t aState, uint8_t aDelay)
 }
 
 
+/** Show an Output (with the delay before it) on the bottom row.
+ */
+void displayInputOutput(uint8_t aOutput, uint8_t aDelay)
+{
+    readOutput(aOutput);
+    disp.printProgStrAt(LCD_COL_START,  LCD_ROW_BOT, M_OUTPUT_TYPES[outputDef.getType()], LCD_COLS);
+    disp.printHexChAt(LCD_COL_OUTPUT_PARAM, LCD_ROW_BOT, (aOutput >> OUTPUT_NODE_SHIFT) & OUTPUT_NODE_MASK);
+    disp.printHexCh(aOutput & OUTPUT_PIN_MASK);
+    disp.printCh(CHAR_SPACE);
+    disp.printHexCh(outputDef.getPace());
+    disp.printCh(CHAR_SPACE);
+    disp.printCh(outputDef.getResetCh());
+    disp.setCursor(-2, LCD_ROW_BOT);
+    disp.printDec(aDelay, 2, CHAR_SPACE);
+}
+
+
+/** Start stepping through the current Input's Outputs, one for each button press.
+ */
+void startPausedInput(boolean aNewState)
+{
+    pausedInput.input = inputNumber;
+    pausedInput.def   = inputDef;
+    pausedInput.state = aNewState;
+    pausedInput.delay = 0;
+    pausedInput.index = aNewState ? 0 : INPUT_OUTPUT_MAX - 1;
+
+    skipPausedDelays();
+    showPausedInput();
+}
+
+
+/** Skip over the paused Input's delays, accumulating them.
+ *  The paused Input is finished if there are no more Outputs.
+ */
+void skipPausedDelays()
+{
+    while (   (pausedInput.index >= 0)
+           && (pausedInput.index < INPUT_OUTPUT_MAX)
+           && (pausedInput.def.isDelay(pausedInput.index)))
+    {
+        pausedInput.delay += pausedInput.def.getOutputPin(pausedInput.index);
+        pausedInput.index += pausedInput.state ? 1 : -1;
+    }
+
+    if (   (pausedInput.index < 0)
+        || (pausedInput.index >= INPUT_OUTPUT_MAX))
+    {
+        pausedInput.index = PAUSE_NONE;
+    }
+}
+
+
+/** Show the paused Input's next Output, waiting for a button press.
+ */
+void showPausedInput()
+{
+    if (pausedInput.index != PAUSE_NONE)
+    {
+        displayInputOutput(pausedInput.def.getOutput(pausedInput.index), pausedInput.delay);
+    }
+}
+
+
+/** A button has been pressed while an Input is paused.
+ *  Action the paused Output, then act on the button.
+ *  If no longer pausing, action all the remaining Outputs.
+ */
+void stepPausedInput(uint8_t aButton)
+{
+    uint8_t  number = inputNumber;
+    InputDef def    = inputDef;
+
+    // Process the paused Input's Outputs in place of the current Input.
+    inputNumber = pausedInput.input;
+    inputDef    = pausedInput.def;
+
+    stepPausedOutput();
+
+    reportPauseButton(aButton);
+
+    while (   (pausedInput.index != PAUSE_NONE)
+           && (!isReportEnabled(REPORT_PAUSE)))
+    {
+        stepPausedOutput();
+    }
+
+    sendOutputBatch();
+
+    inputNumber = number;
+    inputDef    = def;
+}
+
+
+/** Action the paused Input's next Output, it must be the current Input.
+ *  Other Inputs are actioned while it's paused, so its locks are checked again first.
+ *  If it's now locked, the rest of its Outputs are abandoned.
+ */
+void stepPausedOutput()
+{
+    if (isLocked(pausedInput.state))
+    {
+        pausedInput.index = PAUSE_NONE;
+    }
+    else
+    {
+        pausedInput.delay  = processInputOutput(pausedInput.index, pausedInput.state, pausedInput.delay);
+        pausedInput.index += pausedInput.state ? 1 : -1;
+        skipPausedDelays();
+    }
+}
+
+
 /** Process a received command.
  *  Using the contents of the commandBuffer:
  *      iNP - Action input for node N, pin P.
  *      lNP - Action output Lo for node N, pin P.
  *      hNP - Action output Hi for node N, pin P.
  *      oNP - Action output Hi/Lo (based on current state) for node N, pin P.
+ *      sNP - Query the state of output for node N, pin P.
+ *      l** - Action all outputs Lo.
+ *      h** - Action all outputs Hi.
+ *      r** - Reset all outputs to their saved states.
+ *  Output changes are batched, sent when the line ends (see ackCommands()).
+ *  Return the result: the command character, 'l' or 'h' for an output's state, or '?' if not executed.
+ *  Changes to an output return '*', replaced by the state read back once the batch is sent.
  */
-void processCommand()
+char processCommand()
 {
     boolean executed = false;
+    char    result   = commandBuffer[0] | 0x20; // Command character converted to lower-case.
     uint8_t node     = 0;
     uint8_t pin      = 0;
     boolean state    = true;
@@ -664,7 +1213,25 @@ void processCommand()
     }
 
     // Expect three characters, command, nodeId, pinId
-    if (strlen(commandBuffer) == 3)
+    if (   (strlen(commandBuffer) == 3)
+        && (commandBuffer[1] == CHAR_STAR)
+        && (commandBuffer[2] == CHAR_STAR))
+    {
+        // All Outputs.
+        executed = true;
+        switch (commandBuffer[0] | 0x20)            // Command character converted to lower-case.
+        {
+            case 'l': writeAllOutputs(COMMS_ALL_LO);
+                      break;
+            case 'h': writeAllOutputs(COMMS_ALL_HI);
+                      break;
+            case 'r': writeAllOutputs(COMMS_ALL_RESET);
+                      break;
+            default:  executed = false;
+                      break;
+        }
+    }
+    else if (strlen(commandBuffer) == 3)
     {
         node = charToHex(commandBuffer[1]);
         pin  = charToHex(commandBuffer[2]);
@@ -679,13 +1246,23 @@ void processCommand()
                           executed = true;
                       }
                       break;
-            case 'o': state = getOutputState(node, pin);
+            case 's': if (   (node < OUTPUT_NODE_MAX)
+                          && (pin  < OUTPUT_PIN_MAX))
+                      {
+                          sendOutputBatch();                        // So the state is up to date.
+                          result   = getOutputState(node, pin) ? 'h' : 'l';
+                          executed = true;
+                      }
+                      break;
+            case 'o': sendOutputBatch();                            // So the state is up to date.
+                      state = getOutputState(node, pin);
             case 'l': state = !state;
             case 'h': if (   (node < OUTPUT_NODE_MAX)
                           && (pin  < OUTPUT_PIN_MAX))
                       {
-                          writeOutputState(node, pin, state, 0);
-                          readOutputStates(node);                   // Recover states in case LED_4 has moved one.
+                          scheduleOutputState(node, pin, state, 0);  // Replaces any scheduled change.
+                          commandOutputs[commandResultLen] = node * OUTPUT_PIN_MAX + pin;
+                          result   = CHAR_STAR;                      // State is read back when acknowledged.
                           executed = true;
                       }
             default:  break;
@@ -703,6 +1280,50 @@ void processCommand()
         disp.printStr(commandBuffer);
         setDisplayTimeout(getReportDelay());
     }
+
+    return executed ? result : CHAR_QUERY;
+}
+
+
+/** Acknowledge the commands processed so far.
+ *  Send the batched Output changes first (recovers states in case LED_4 has moved one).
+ *  Changed Outputs report the state read back from their module, so a locked or failed change shows,
+ *  or '?' if the module isn't present.
+ *  Prints "#<sequence> <results>", the sequence number (decimal) of the first command and a result character for each command.
+ */
+void ackCommands()
+{
+    sendOutputBatch();
+
+    if (commandResultLen > 0)
+    {
+        for (uint8_t index = 0; index < commandResultLen; index++)
+        {
+            if (commandResults[index] == CHAR_STAR)
+            {
+                uint8_t node = commandOutputs[index] / OUTPUT_PIN_MAX;
+                uint8_t pin  = commandOutputs[index] % OUTPUT_PIN_MAX;
+
+                if (!isOutputNodePresent(node))
+                {
+                    commandResults[index] = CHAR_QUERY;
+                }
+                else
+                {
+                    commandResults[index] = getOutputState(node, pin) ? 'h' : 'l';
+                }
+            }
+        }
+
+        commandResults[commandResultLen] = CHAR_NULL;
+        Serial.print(CHAR_HASH);
+        Serial.print(commandSequence);
+        Serial.print(CHAR_SPACE);
+        Serial.println(commandResults);
+
+        commandSequence += commandResultLen;
+        commandResultLen = 0;
+    }
 }
 
 
@@ -722,10 +1343,53 @@ void processCommand()
 //}
 
     
+/** Paint the free RAM between the heap and the stack.
+ *  The stack overwrites the paint as it grows, so checkStack() can find its deepest reach.
+ */
+void paintStack()
+{
+    for (uint8_t *ram = __brkval ? __brkval : &__heap_start; ram < (uint8_t *)SP; ram++)
+    {
+        *ram = STACK_PAINT;
+    }
+}
+
+
+/** Report the stack's headroom whenever it's less than before.
+ *  Headroom is the painted RAM the stack has never reached, including while menus are nested.
+ */
+void checkStack()
+{
+    if (isDebug(DEBUG_BRIEF))
+    {
+        uint16_t headroom = 0;
+        for (uint8_t *ram = __brkval ? __brkval : &__heap_start; (ram < (uint8_t *)SP) && (*ram == STACK_PAINT); ram++)
+        {
+            headroom += 1;
+        }
+
+        if (headroom < stackHeadroom)
+        {
+            stackHeadroom = headroom;
+
+            Serial.print(millis());
+            Serial.print(CHAR_TAB);
+            Serial.print(PGMT(M_DEBUG_STACK));
+            Serial.print(PGMT(M_DEBUG_HEADROOM));
+            Serial.print(stackHeadroom);
+            Serial.println();
+        }
+    }
+}
+
+
 /** Setup the Arduino.
  */
 void setup()
 {
+    // Paint free RAM first, so the stack's deepest reach can be found.
+    paintStack();
+
     // Start Serial IO  first - needed if there's any debug output.
     Serial.begin(SERIAL_SPEED);
 
@@ -735,7 +1399,13 @@ void setup()
     lcdShield = !digitalRead(LCD_SHIELD_DETECT_PIN);
 #endif
 
+    // Input nodes' INT pins pull the INPUT_INTERRUPT_PIN low.
+#if INPUT_INTERRUPT_PIN
+    pinMode(INPUT_INTERRUPT_PIN, INPUT_PULLUP);
+#endif
+
     Serial.println("Starting");
+    disp.flush(LCD2_CELLS);
     delay(4000);
 
     // Initial announcement/splash message.
@@ -743,8 +1413,7 @@ void setup()
     disp.printProgStrAt(LCD_COL_START, LCD_ROW_DET, M_INIT_I2C, LCD_LEN_STATUS);
     
     // Initialise I2C.
-    Wire.begin(I2C_CONTROLLER_ID);          // I2C network
-    // Wire.setTimeout(25000L);             // Doesn't seem to have any effect.
+    initHealth();                           // I2C network, with a timeout.
 
 #if LCD_I2C
     // Scan for i2c LCD.
@@ -766,6 +1435,9 @@ void setup()
     initButtonPins();                           // Initialise alternate button pins.
     flashVersion();                             // Flash our version number on the built-in LED.
 
+    // Load the Input types and empty the cache of Inputs.
+    initInputCache();
+
     // Deal with first run (software has never been run before).
     if (!loadSystemData())
     {
@@ -801,7 +1473,8 @@ void setup()
         disp.printProgStrAt(LCD_COL_START, LCD_ROW_DET, M_UPDATE, LCD_LEN_STATUS);
 
         // Do the update here.
-        waitForButtonClick();           // Nothing to do, just show it's happening.
+        indexInputs();                  // Rebuild the index of Inputs, earlier versions don't have one.
+        waitForButtonClick();
         
         systemData.version = VERSION;
         saveSystemData();
@@ -812,56 +1485,214 @@ void setup()
 }
 
 
+/** Operate the layout.
+ *  Probe for hardware, scan the Inputs, and action their changes.
+ */
+void operateLayout()
+{
+    now = millis();
+
+    // Probe for new hardware
+    if (now > tickHardwareScan)
+    {
+        tickHardwareScan = now + STEP_HARDWARE_PROBE;
+        probeHardware();
+    }
+    
+    // Process any inputs (unless Configuration is selecting one, it scans them itself).
+    if (   (now > tickInputScan)
+        && (!selecting))
+    {
+        if (   (!inputInterrupts)
+            || (now > tickInputPoll))
+        {
+            // Scan all the Inputs, either because they don't interrupt, or occasionally in case an interrupt is missed.
+            boolean interrupt = isInputInterrupt();
+
+            tickInputScan = now + STEP_INPUT_SCAN;
+            tickInputPoll = now + STEP_INPUT_POLL;
+            if (scanInputs(false))
+            {
+                // Inputs keep changing without an interrupt, so the INT pins can't be wired.
+                // A single miss may just be a change starting between sampling the pin and the scan.
+                inputInterruptMisses = interrupt ? 0 : inputInterruptMisses + 1;
+                if (inputInterruptMisses >= INPUT_INTERRUPT_MISSES)
+                {
+                    inputInterrupts = false;
+                }
+            }
+        }
+        else
+        {
+            // Scan just the Inputs that have changed, or are being debounced.
+            tickInputScan = now + STEP_INPUT_SCAN;
+            scanInputInterrupts(isInputInterrupt());
+        }
+    }
+
+    // Action the oldest Input change, one per loop so scanning isn't held up.
+    dispatchInputEvent();
+
+    // Send any delayed Output changes that are now due.
+    sendOutputTimeline();
+
+    // Catch up with the states of Output nodes that were too busy to report them.
+    if (outputStatesDue)
+    {
+        readDueOutputStates();
+    }
+
+    // Then display what's been done (not over the Configuration menus).
+    if (!background)
+    {
+        showReports();
+    }
+}
+
+
+/** Delay for an interval.
+ *  If configuring, keep the layout operating meanwhile.
+ *  The Input and Output being configured are preserved, and reporting is suppressed so the menus aren't disturbed.
+ */
+void delayOperating(long aInterval)
+{
+    if (   (!configuring)
+        || (background))
+    {
+        disp.flush(LCD2_CELLS);         // Nothing else to do, so show everything.
+        delay(aInterval);
+    }
+    else
+    {
+        long      endAt  = millis() + aInterval;
+
+        // Preserve the Input and Output being configured.
+        uint8_t   number = inputNumber;
+        InputDef  inpDef = inputDef;
+        uint32_t  types  = inputTypes;
+        uint8_t   type   = inputType;
+        uint8_t   node   = outputNode;
+        uint8_t   pin    = outputPin;
+        OutputDef outDef = outputDef;
+
+        background = true;
+        do
+        {
+            operateLayout();
+            disp.flush(LCD2_FLUSH_MAX);
+        }
+        while (millis() < endAt);
+        background = false;
+
+        inputNumber = number;
+        inputDef    = inpDef;
+        inputTypes  = types;
+        inputType   = type;
+        outputNode  = node;
+        outputPin   = pin;
+        outputDef   = outDef;
+    }
+}
+
+
+/** Run the Configuration menus.
+ */
+void runConfigure()
+{
+    boolean wasConfiguring = configuring;
+    
+    configuring = true;
+    configure.run();
+    configuring = wasConfiguring;
+
+    if (!configuring)
+    {
+        announce();
+    }
+}
+
+
 /** Main loop.
  */
 void loop()
 {
-    // Press any button to configure.
-    if (readButton())
+    // Read the buttons, occasionally so they're debounced.
+    if (millis() > tickButton)
     {
-        configure.run();
-        announce();
+        uint8_t button = readButton();
+        tickButton = millis() + DELAY_BUTTON_WAIT;
+
+        if (button != loopButton)
+        {
+            if (loopButton != BUTTON_NONE)
+            {
+                // Released, show the paused Input's next Output.
+                if (pauseStepped)
+                {
+                    pauseStepped = false;
+                    disp.clearRow(LCD_COL_START, LCD_ROW_BOT);
+                    showPausedInput();
+                }
+            }
+            else if (pausedInput.index != PAUSE_NONE)
+            {
+                // Step through the paused Input.
+                pauseStepped = true;
+                stepPausedInput(button);
+            }
+            else
+            {
+                // Press any button to configure.
+                runConfigure();
+                button = readButton();
+            }
+            
+            loopButton = button;
+        }
     }
 
-    // Look for command characters    
+    // Look for command characters.
+    // Commands are separated by spaces or semi-colons, and acknowledged at the end of each line.
     while (Serial.available() > 0)
     {
         char ch = Serial.read();
-        if (ch == '\n')
+        if (   (ch == CHAR_SPACE)
+            || (ch == CHAR_TAB)
+            || (ch == CHAR_SEMI)
+            || (ch == CHAR_RETURN)
+            || (ch == CHAR_NEWLINE))
         {
             // Process the received command
-            commandBuffer[commandLen] = CHAR_NULL;
-            processCommand();
-            commandLen = 0;
+            if (commandLen > 0)
+            {
+                commandBuffer[commandLen] = CHAR_NULL;
+                commandResults[commandResultLen++] = processCommand();
+                commandLen = 0;
+            }
+
+            if (   (ch == CHAR_NEWLINE)
+                || (commandResultLen >= COMMAND_RESULT_MAX))
+            {
+                ackCommands();
+            }
         }
-        else if (commandLen <= COMMAND_BUFFER_LEN)
+        else if (commandLen < COMMAND_BUFFER_LEN)
         {
             commandBuffer[commandLen++] = ch;
         }
     }    
 
-    now = millis();
+    // Keep the layout operating.
+    operateLayout();
 
-    // Rescan for new hardware
-    if (now > tickHardwareScan)
-    {
-        tickHardwareScan = now + STEP_HARDWARE_SCAN;
-        scanInputHardware();
-        scanOutputHardware();
-    }
-    
-    // Process any inputs
-    if (now > tickInputScan)
-    {
-        tickInputScan = now + STEP_INPUT_SCAN;
-        // scanOutputs();
-        scanInputs(false);
-    }
+    // Send some of the display's changes.
+    disp.flush(LCD2_FLUSH_MAX);
     
     // Show heartbeat.
     if (now > tickHeartBeat)
     {
         tickHeartBeat = now + STEP_HEARTBEAT;
+        checkStack();
         
         // If display timeout has expired, clear it.
         if (   (displayTimeout > 0)
@@ -20,7 +20,7 @@
     #define MAGIC_NUMBER 0x74756f53         // Magic number = "Sout".
 #endif
 
-#define VERSION         0x0351              // Version number of software.  See also M_VERSION.
+#define VERSION         0x0352              // Version number of software.  See also M_VERSION.
 
 
 // Timing constants
@@ -69,7 +69,12 @@
     #define INPUT_MAX    (INPUT_NODE_MAX * INPUT_PIN_MAX)               // Maximum inputs (16 nodes with 8 pins each).
     #define INPUT_END    (INPUT_BASE + INPUT_SIZE * INPUT_MAX)          // End of Input EEPROM.
 
-    #define EEPROM_END   INPUT_END                                      // End of EEPROM memory
+    // Index of the Input nodes that drive each Output node, saved in EEPROM
+    #define INDEX_BASE   INPUT_END                                      // EEPROM base of Input index.
+    #define INDEX_SIZE   1                                              // Size of an Output node's entry, bit map of Input nodes.
+    #define INDEX_END    (INDEX_BASE + INDEX_SIZE * OUTPUT_NODE_MAX)    // End of Input index EEPROM.
+
+    #define EEPROM_END   INDEX_END                                      // End of EEPROM memory
 
 #else
 
@@ -78,7 +83,13 @@
     #define OUTPUT_SIZE  sizeof(OutputDef)                              // Size of OutputData entry.
     #define OUTPUT_END   (OUTPUT_BASE + OUTPUT_SIZE * OUTPUT_PIN_MAX)   // End of OutputData EEPROM.
 
-    #define EEPROM_END   OUTPUT_END                                     // End of EEPROM memory
+    // Journal of the Outputs' states saved in EEPROM, a ring of entries to spread the wear.
+    #define JOURNAL_BASE OUTPUT_END                                     // EEPROM base of the state journal.
+    #define JOURNAL_SIZE 3                                              // Size of an entry: sequence, states, check.
+    #define JOURNAL_MAX  250                                            // Number of entries, fewer than the sequence numbers.
+    #define JOURNAL_END  (JOURNAL_BASE + JOURNAL_SIZE * JOURNAL_MAX)    // End of the journal EEPROM.
+
+    #define EEPROM_END   JOURNAL_END                                    // End of EEPROM memory
 
 #endif
 
@@ -114,6 +125,7 @@ const char CHAR_STAR    = '*';
 //const char CHAR_DASH    = '-';
 const char CHAR_DOT     = '.';
 const char CHAR_COLON   = ':';
+const char CHAR_SEMI    = ';';
 const char CHAR_LEFT    = '<';
 const char CHAR_RIGHT   = '>';
 const char CHAR_QUERY   = '?';